@@ -0,0 +1,218 @@
+#include "BatchProcessor.h"
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+
+using namespace cv;
+using namespace std;
+
+namespace seam {
+
+struct BatchProcessor::Job {
+	Mat image;
+	int64 start = 0;
+	double latencyMs = 0;
+	bool succeeded = false;
+	string error;
+	Profile profile;
+};
+
+// Images in flight per worker: enough that a worker always finds a read or write to overlap with
+// carving, few enough that decoded images don't pile up in memory
+static const int JobsPerWorker = 2;
+
+bool readBatchManifest(const string& path, const string& outputDir, vector<BatchItem>& items) {
+	ifstream manifest(path);
+	if (!manifest)
+		return false;
+
+	string line;
+	while (getline(manifest, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		BatchItem item;
+		size_t tab = line.find('\t');
+		item.input = line.substr(0, tab);
+		item.output = tab == string::npos ? batchOutputPath(item.input, outputDir) : line.substr(tab + 1);
+		items.push_back(item);
+	}
+	return true;
+}
+
+vector<BatchItem> listBatchDirectory(const string& dir, const string& outputDir) {
+	static const char* extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp" };
+
+	vector<String> paths;
+	glob(dir + "/*", paths, false);
+
+	vector<BatchItem> items;
+	for (const String& path : paths) {
+		size_t dot = path.find_last_of('.');
+		if (dot == string::npos)
+			continue;
+		string extension = path.substr(dot);
+		transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+		if (find(begin(extensions), end(extensions), extension) != end(extensions))
+			items.push_back({ path, batchOutputPath(path, outputDir) });
+	}
+	return items;
+}
+
+string batchOutputPath(const string& input, const string& outputDir) {
+	size_t slash = input.find_last_of("/\\");
+	if (!outputDir.empty())
+		return outputDir + "/" + (slash == string::npos ? input : input.substr(slash + 1));
+
+	size_t dot = input.find_last_of('.');
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+		return input + "_carved.png";
+	return input.substr(0, dot) + "_carved" + input.substr(dot);
+}
+
+BatchProcessor::BatchProcessor(int threads)
+	: pool(threads), carvers(pool.size()) {
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const vector<double>& sorted, double p) {
+	if (sorted.empty())
+		return 0;
+	size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+	return sorted[min(max(rank, size_t(1)), sorted.size()) - 1];
+}
+
+BatchStats BatchProcessor::run(const vector<BatchItem>& items, Size target, const Options& options) {
+	vector<Job> work(items.size());
+	batch = &items;
+	jobs = work.data();
+	targetSize = target;
+	carveOptions = options;
+
+	// The pool already uses every core, so each job carves on its worker thread only; threading inside
+	// a job would just oversubscribe
+	carveOptions.threads = 1;
+	uint64_t stealsBefore = pool.stolenTasks();
+
+	int64 start = getTickCount();
+	size_t window = min(items.size(), static_cast<size_t>(pool.size() * JobsPerWorker));
+	nextItem = window;
+	for (size_t i = 0; i < window; i++)
+		pool.submit([this, i] { read(i); });
+	pool.wait();
+	double seconds = (getTickCount() - start) / getTickFrequency();
+
+	BatchStats stats;
+	vector<double> latencies;
+	for (size_t i = 0; i < items.size(); i++) {
+		stats.jobProfiles.push_back(work[i].profile);
+		stats.profile.merge(work[i].profile);
+		if (work[i].succeeded) {
+			stats.succeeded++;
+			latencies.push_back(work[i].latencyMs);
+		}
+		else {
+			stats.failed++;
+			stats.errors.push_back(items[i].input + ": " + work[i].error);
+		}
+	}
+	sort(latencies.begin(), latencies.end());
+
+	stats.seconds = seconds;
+	stats.imagesPerSecond = seconds > 0 ? stats.succeeded / seconds : 0;
+	stats.p50Ms = percentile(latencies, 0.50);
+	stats.p99Ms = percentile(latencies, 0.99);
+	stats.maxMs = latencies.empty() ? 0 : latencies.back();
+	stats.stolenTasks = pool.stolenTasks() - stealsBefore;
+
+	batch = nullptr;
+	jobs = nullptr;
+	return stats;
+}
+
+// Stage 1: decode
+void BatchProcessor::read(size_t index) {
+	Job& job = jobs[index];
+	job.start = getTickCount();
+	try {
+		job.image = imread((*batch)[index].input, IMREAD_UNCHANGED);
+	}
+	// cv::Exception is a std::exception; anything else thrown still only fails this file
+	catch (const exception& e) {
+		job.error = e.what();
+	}
+	catch (...) {
+		job.error = "unknown error";
+	}
+
+	if (job.image.empty()) {
+		if (job.error.empty())
+			job.error = "cannot read image";
+		finish(index);
+	}
+	else if (targetSize.width > job.image.cols || targetSize.height > job.image.rows) {
+		job.error = "target exceeds the image size " + to_string(job.image.cols) + "x" + to_string(job.image.rows);
+		job.image.release();
+		finish(index);
+	}
+	else
+		pool.submit([this, index] { carve(index); });
+}
+
+// Stage 2: carve with the calling worker's own SeamCarver
+void BatchProcessor::carve(size_t index) {
+	Job& job = jobs[index];
+	try {
+		SeamCarver& carver = carvers[pool.currentWorker()];
+		job.image = carver.retarget(job.image, targetSize, carveOptions);
+		job.profile = carver.profile();
+	}
+	catch (const exception& e) {
+		fail(index, e.what());
+		return;
+	}
+	catch (...) {
+		fail(index, "unknown error");
+		return;
+	}
+	pool.submit([this, index] { write(index); });
+}
+
+// Stage 3: encode
+void BatchProcessor::write(size_t index) {
+	Job& job = jobs[index];
+	try {
+		job.succeeded = imwrite((*batch)[index].output, job.image);
+		if (!job.succeeded)
+			job.error = "cannot write " + (*batch)[index].output;
+	}
+	catch (const exception& e) {
+		job.error = e.what();
+	}
+	catch (...) {
+		job.error = "unknown error";
+	}
+	job.image.release();
+	job.latencyMs = (getTickCount() - job.start) * 1e3 / getTickFrequency();
+	finish(index);
+}
+
+// A stage threw: record it against this file and drop the image
+void BatchProcessor::fail(size_t index, const string& error) {
+	jobs[index].error = error;
+	jobs[index].image.release();
+	finish(index);
+}
+
+// An image left the pipeline, let the next one in
+void BatchProcessor::finish(size_t) {
+	size_t next = nextItem++;
+	if (next < batch->size())
+		pool.submit([this, next] { read(next); });
+}
+
+} // namespace seam
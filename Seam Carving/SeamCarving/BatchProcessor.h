@@ -0,0 +1,75 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include "SeamCarver.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+namespace seam {
+
+struct BatchItem {
+	std::string input;
+	std::string output;
+};
+
+struct BatchStats {
+	int succeeded = 0;
+	int failed = 0;
+	double seconds = 0;			// wall time of the whole batch
+	double imagesPerSecond = 0;
+	double p50Ms = 0, p99Ms = 0, maxMs = 0;	// per-image latency, read start to write end
+	uint64_t stolenTasks = 0;
+
+	// Per-phase profile of every item (in input order, empty for failures) and their sum
+	std::vector<Profile> jobProfiles;
+	Profile profile;
+
+	// "input: reason" for every image that failed
+	std::vector<std::string> errors;
+};
+
+// Images listed in a manifest: one input path per line, optionally followed by a tab and the output
+// path. Blank lines and lines starting with '#' are skipped. Returns false if the file can't be read.
+bool readBatchManifest(const std::string& path, const std::string& outputDir, std::vector<BatchItem>& items);
+
+// Every image (jpg, jpeg, png, bmp, tif, tiff, webp) directly inside dir
+std::vector<BatchItem> listBatchDirectory(const std::string& dir, const std::string& outputDir);
+
+// outputDir/<name> when outputDir is set, <input without extension>_carved.<ext> otherwise
+std::string batchOutputPath(const std::string& input, const std::string& outputDir);
+
+// Carves many independent images on a persistent thread pool. Each image goes through three tasks,
+// read -> carve -> write, so while one worker carves others are decoding or encoding; the pool's
+// work stealing keeps every worker busy when image sizes differ a lot. Only a window of images is in
+// flight at a time, which bounds memory. Each worker keeps its own SeamCarver, so DP buffers are
+// reused across the images that worker carves.
+class BatchProcessor {
+public:
+	// threads <= 0 uses one worker per hardware thread
+	explicit BatchProcessor(int threads = 0);
+
+	BatchStats run(const std::vector<BatchItem>& items, cv::Size target, const Options& options = Options());
+
+	int threads() const { return pool.size(); }
+
+private:
+	struct Job;
+
+	void read(size_t index);
+	void carve(size_t index);
+	void write(size_t index);
+	void finish(size_t index);
+	void fail(size_t index, const std::string& error);
+
+	ThreadPool pool;
+	std::vector<SeamCarver> carvers;
+
+	// Per-run state, only touched from run() and the tasks it starts
+	const std::vector<BatchItem>* batch = nullptr;
+	Job* jobs = nullptr;
+	cv::Size targetSize;
+	Options carveOptions;
+	std::atomic<size_t> nextItem{ 0 };
+};
+
+} // namespace seam
@@ -0,0 +1,1104 @@
+#include "Benchmark.h"
+#include "DPKernels.h"
+#include "Energy.h"
+#include "SeamCarver.h"
+#include "SeamCarving.h"
+#include "SeamIndexFile.h"
+#include "SeamIndexMap.h"
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+using namespace seam;
+
+// Sample images; the CMake build points this at the source tree's Assets directory
+#ifndef SEAM_ASSETS_DIR
+#define SEAM_ASSETS_DIR "../SeamCarving/Assets"
+#endif
+
+// Seconds elapsed since the tick count start
+static double secondsSince(int64 start) {
+	return (getTickCount() - start) / getTickFrequency();
+}
+
+static int intArg(int argc, char** argv, int index, int fallback) {
+	return index < argc ? atoi(argv[index]) : fallback;
+}
+
+// L1 data-cache read misses and last-level cache misses of the calling thread between start() and
+// stop(), from the Linux perf events. Elsewhere, or when the kernel refuses the counters (e.g.
+// perf_event_paranoid or a container), available() is false and reason() says why.
+class CacheMisses {
+public:
+	CacheMisses() {
+#ifdef __linux__
+		fds[0] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+		fds[1] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+		if (fds[0] < 0 || fds[1] < 0)
+			why = string("perf_event_open failed: ") + strerror(errno);
+#else
+		why = "needs Linux perf events";
+#endif
+	}
+	~CacheMisses() {
+#ifdef __linux__
+		for (int fd : fds)
+			if (fd >= 0)
+				close(fd);
+#endif
+	}
+	CacheMisses(const CacheMisses&) = delete;
+	CacheMisses& operator=(const CacheMisses&) = delete;
+
+	bool available() const { return why.empty(); }
+	const string& reason() const { return why; }
+
+	void start() {
+#ifdef __linux__
+		if (!available())
+			return;
+		for (int fd : fds) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+	void stop() {
+#ifdef __linux__
+		if (!available())
+			return;
+		uint64_t* counts[2] = { &l1, &llc };
+		for (int c = 0; c < 2; c++) {
+			ioctl(fds[c], PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fds[c], counts[c], sizeof(uint64_t)) != sizeof(uint64_t))
+				*counts[c] = 0;
+		}
+#endif
+	}
+
+	// "  L1D x.xxM  LLC x.xxM" per run of the last start()/stop() over runs, or nothing
+	string columns(int runs) const {
+		if (!available())
+			return "";
+		ostringstream out;
+		out << fixed << setprecision(2) << "  L1D " << setw(7) << l1 / 1e6 / runs << "M  LLC " << setw(6) << llc / 1e6 / runs << "M";
+		return out.str();
+	}
+
+	// One line saying what the miss columns are, or why there are none
+	void describe(ostream& out) const {
+		if (available())
+			out << "  cache misses per run: L1 data reads and last level" << endl;
+		else
+			out << "  cache misses not measured (" << why << ")" << endl;
+	}
+
+private:
+#ifdef __linux__
+	static int openCounter(uint32_t type, uint64_t config) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	int fds[2] = { -1, -1 };
+#endif
+	string why;
+	uint64_t l1 = 0, llc = 0;
+};
+
+// Image of the benchmarks that carve a picture: argv[0] when it is not a number, otherwise
+// Assets/Broadway_tower.jpg. Seam quality figures only mean something on a real photo, so a random
+// 1920 x 1080 frame stands in (with a warning) only when the asset cannot be read. *argOffset is the
+// index of the first argument after the image and *name what to print for it; an unreadable file given
+// on the command line is reported and comes back empty.
+static Mat loadBenchImage(int argc, char** argv, int* argOffset, string* name) {
+	if (argc > 0 && !isdigit(static_cast<unsigned char>(argv[0][0]))) {
+		*argOffset = 1;
+		*name = argv[0];
+		Mat img = imread(argv[0]);
+		if (img.empty())
+			cerr << "cannot read " << argv[0] << endl;
+		return img;
+	}
+
+	*argOffset = 0;
+	*name = SEAM_ASSETS_DIR "/Broadway_tower.jpg";
+	Mat img = imread(*name);
+	if (img.empty()) {
+		cerr << "warning: cannot read " << *name << ", using a random frame; quality figures are meaningless on it" << endl;
+		*name = "random frame";
+		img.create(1080, 1920, CV_8UC3);
+		randu(img, Scalar::all(0), Scalar::all(256));
+	}
+	return img;
+}
+
+// dp-row [cols] [rows] [repeats]: per-row throughput of each DP row kernel on random energy
+static int benchDPRow(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 8192);
+	int rows = intArg(argc, argv, 1, 512);
+	int repeats = intArg(argc, argv, 2, 20);
+
+	Mat energy(rows, cols, CV_8U);
+	randu(energy, Scalar(0), Scalar(256));
+
+	size_t cells = static_cast<size_t>(rows) * cols;
+	vector<int> reference(cells), costs(cells);
+	vector<schar> referencePath(cells), path(cells);
+
+	// Fill the whole table with a kernel, first row is just the energy
+	auto fill = [&](DPRowKernel kernel, vector<int>& cost, vector<schar>& parent) {
+		for (int j = 0; j < cols; j++)
+			cost[j] = energy.at<uchar>(0, j);
+		for (int i = 1; i < rows; i++)
+			kernel(&cost[static_cast<size_t>(i - 1) * cols], energy.ptr<uchar>(i),
+				&cost[static_cast<size_t>(i) * cols], &parent[static_cast<size_t>(i) * cols], cols, 0, cols);
+	};
+	fill(dpRowScalar, reference, referencePath);
+
+	cout << "dp-row: " << cols << " x " << rows << ", " << repeats << " repeats, dispatch picks " << getDPRowKernelName() << endl;
+
+	DPRowKernelInfo kernels[8];
+	int count = getDPRowKernels(kernels, 8);
+	double scalarTime = 0;
+	int mismatches = 0;
+	for (int k = 0; k < count; k++) {
+		if (!kernels[k].kernel) {
+			cout << "  " << setw(8) << kernels[k].name << "  not supported on this CPU" << endl;
+			continue;
+		}
+
+		fill(kernels[k].kernel, costs, path);
+		bool identical = costs == reference && memcmp(&path[cols], &referencePath[cols], cells - cols) == 0;
+		mismatches += !identical;
+
+		int64 start = getTickCount();
+		for (int r = 0; r < repeats; r++)
+			fill(kernels[k].kernel, costs, path);
+		double seconds = secondsSince(start) / repeats;
+		if (k == 0)
+			scalarTime = seconds;
+
+		cout << "  " << setw(8) << kernels[k].name
+			<< fixed << setprecision(1)
+			<< "  " << setw(9) << seconds * 1e9 / (rows - 1) << " ns/row"
+			<< "  " << setw(7) << (rows - 1) * static_cast<double>(cols) / seconds / 1e6 << " Mcells/s"
+			<< setprecision(2) << "  x" << scalarTime / seconds
+			<< (identical ? "" : "  MISMATCH vs scalar") << endl;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
+
+// dp-parallel [cols] [rows] [repeats]: whole-table fill on 1, 2, 4, ... threads (up to OpenCV's thread
+// count) for a few block heights, against the serial fill, on an 8K frame of random energy by default
+static int benchDPParallel(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 7680);
+	int rows = intArg(argc, argv, 1, 4320);
+	int repeats = intArg(argc, argv, 2, 10);
+
+	Mat energy(rows, cols, CV_8U);
+	randu(energy, Scalar(0), Scalar(256));
+
+	size_t cells = static_cast<size_t>(rows) * cols;
+	vector<int> reference(cells), costs(cells);
+	vector<schar> referencePath(cells), path(cells);
+
+	int64 start = getTickCount();
+	for (int r = 0; r < repeats; r++)
+		fillCostTable(energy.data, energy.step, rows, cols, reference.data(), referencePath.data());
+	double serialTime = secondsSince(start) / repeats;
+
+	int maxThreads = getNumThreads();
+	int mismatches = 0;
+	cout << "dp-parallel: " << cols << " x " << rows << ", " << repeats << " repeats, up to " << maxThreads << " threads" << endl;
+	cout << "  serial          " << fixed << setprecision(2) << setw(8) << serialTime * 1e3 << " ms" << endl;
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		setNumThreads(threads);
+		for (int blockRows : { 8, 32, 128 }) {
+			fillCostTableParallel(energy.data, energy.step, rows, cols, costs.data(), path.data(), threads, blockRows);
+			bool identical = costs == reference && memcmp(&path[cols], &referencePath[cols], cells - cols) == 0;
+			mismatches += !identical;
+
+			start = getTickCount();
+			for (int r = 0; r < repeats; r++)
+				fillCostTableParallel(energy.data, energy.step, rows, cols, costs.data(), path.data(), threads, blockRows);
+			double seconds = secondsSince(start) / repeats;
+
+			cout << "  " << setw(2) << threads << " threads r=" << left << setw(3) << blockRows << right
+				<< setprecision(2) << "  " << setw(8) << seconds * 1e3 << " ms"
+				<< "  " << setw(7) << cells / seconds / 1e6 << " Mcells/s"
+				<< "  x" << setw(5) << serialTime / seconds
+				<< (identical ? "" : "  MISMATCH vs serial") << endl;
+		}
+	}
+	setNumThreads(maxThreads);
+	return mismatches == 0 ? 0 : 1;
+}
+
+// dp-tiled [cols] [rows] [repeats]: single-threaded whole-table fill row by row and in skewed tiles, on
+// a very wide random energy map, with the cache misses per fill where perf events are available. GB/s
+// counts the energy read and the table written (6 bytes per cell).
+static int benchDPTiled(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 32768);
+	int rows = intArg(argc, argv, 1, 512);
+	int repeats = intArg(argc, argv, 2, 10);
+
+	Mat energy(rows, cols, CV_8U);
+	randu(energy, Scalar(0), Scalar(256));
+
+	size_t cells = static_cast<size_t>(rows) * cols;
+	vector<int> reference(cells), costs(cells);
+	vector<schar> referencePath(cells), path(cells);
+
+	int mismatches = 0;
+	CacheMisses misses;
+	auto report = [&](const string& name, double seconds, double baseTime, bool identical) {
+		mismatches += !identical;
+		cout << "  " << left << setw(20) << name << right << fixed
+			<< setprecision(2) << "  " << setw(8) << seconds * 1e3 << " ms"
+			<< "  " << setw(6) << cells * 6.0 / seconds / 1e9 << " GB/s"
+			<< "  x" << setw(5) << baseTime / seconds
+			<< misses.columns(repeats)
+			<< (identical ? "" : "  MISMATCH vs row by row") << endl;
+	};
+
+	cout << "dp-tiled: " << cols << " x " << rows << ", " << repeats << " repeats" << endl;
+	misses.describe(cout);
+
+	fillCostTable(energy.data, energy.step, rows, cols, reference.data(), referencePath.data());
+	int64 start = getTickCount();
+	misses.start();
+	for (int r = 0; r < repeats; r++)
+		fillCostTable(energy.data, energy.step, rows, cols, reference.data(), referencePath.data());
+	misses.stop();
+	double rowTime = secondsSince(start) / repeats;
+	report("row by row", rowTime, rowTime, true);
+
+	for (int tileCols : { 512, 1024, 2048, 4096, 8192 }) {
+		for (int blockRows : { 16, 64, 256 }) {
+			fillCostTableTiled(energy.data, energy.step, rows, cols, costs.data(), path.data(), tileCols, blockRows);
+			bool identical = costs == reference && memcmp(&path[cols], &referencePath[cols], cells - cols) == 0;
+
+			start = getTickCount();
+			misses.start();
+			for (int r = 0; r < repeats; r++)
+				fillCostTableTiled(energy.data, energy.step, rows, cols, costs.data(), path.data(), tileCols, blockRows);
+			misses.stop();
+			report("tile " + to_string(tileCols) + " x " + to_string(blockRows), secondsSince(start) / repeats, rowTime, identical);
+		}
+	}
+	return mismatches == 0 ? 0 : 1;
+}
+
+// The vertical seam as findVerticalSeam found it before the parent table shrank: the same row kernel,
+// but every parent widened to its absolute column in a rows x cols int table. Baseline for dp-seam.
+static vector<int> findVerticalSeamIntParents(const Mat& energy, vector<int>& costs, vector<int>& parents, vector<schar>& offsets) {
+	int rows = energy.rows, cols = energy.cols;
+	DPRowKernel fillRow = getDPRowKernel();
+	for (int j = 0; j < cols; j++)
+		costs[j] = energy.ptr<uchar>(0)[j];
+	for (int i = 1; i < rows; i++) {
+		int* cur = &costs[static_cast<size_t>(i) * cols];
+		int* parent = &parents[static_cast<size_t>(i) * cols];
+		fillRow(cur - cols, energy.ptr<uchar>(i), cur, offsets.data(), cols, 0, cols);
+		for (int j = 0; j < cols; j++)
+			parent[j] = j + offsets[j];
+	}
+
+	const int* last = &costs[static_cast<size_t>(rows - 1) * cols];
+	int minSeam = min_element(last, last + cols) - last;
+	vector<int> seam(rows);
+	for (int i = rows - 1; i >= 0; i--) {
+		seam[i] = minSeam;
+		if (i > 0)
+			minSeam = parents[static_cast<size_t>(i) * cols + minSeam];
+	}
+	return seam;
+}
+
+// dp-seam [cols] [rows] [repeats]: whole findVerticalSeam per parent encoding against an int parent table,
+// with the table footprint and, where perf events are available, the cache misses per seam. The default
+// is an 8K frame (8192 x 4320), where the int table alone is far larger than any last level cache.
+static int benchDPSeam(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 8192);
+	int rows = intArg(argc, argv, 1, 4320);
+	int repeats = intArg(argc, argv, 2, 5);
+
+	Mat energy(rows, cols, CV_8U);
+	randu(energy, Scalar(0), Scalar(256));
+
+	cout << "dp-seam: " << cols << " x " << rows << ", " << repeats << " repeats, " << getDPRowKernelName() << " row kernel" << endl;
+	CacheMisses misses;
+	misses.describe(cout);
+
+	// The cost table is the same for every variant, only the parent table differs
+	double costMB = static_cast<double>(rows) * cols * sizeof(int) / (1 << 20);
+	int mismatches = 0;
+	auto report = [&](const char* name, double seconds, double parentMB, bool identical) {
+		cout << "  " << setw(8) << name
+			<< fixed << setprecision(2)
+			<< "  " << setw(8) << seconds * 1e3 << " ms/seam"
+			<< "  parents " << setw(7) << parentMB << " MB (costs " << costMB << " MB)"
+			<< misses.columns(repeats)
+			<< (identical ? "" : "  MISMATCH") << endl;
+		mismatches += !identical;
+	};
+
+	size_t cells = static_cast<size_t>(rows) * cols;
+	vector<int> reference;
+	{
+		vector<int> costs(cells), parents(cells);
+		vector<schar> offsets(cols);
+		reference = findVerticalSeamIntParents(energy, costs, parents, offsets);
+
+		int64 start = getTickCount();
+		misses.start();
+		for (int r = 0; r < repeats; r++)
+			findVerticalSeamIntParents(energy, costs, parents, offsets);
+		misses.stop();
+		report("int", secondsSince(start) / repeats, static_cast<double>(cells) * sizeof(int) / (1 << 20), true);
+	}
+
+	const struct {
+		const char* name;
+		ParentEncoding encoding;
+	} encodings[] = {
+		{ "offset8", ParentEncoding::Offset8 },
+		{ "packed2", ParentEncoding::Packed2 },
+	};
+
+	for (const auto& entry : encodings) {
+		SeamFinderContext ctx(rows, cols, entry.encoding);
+		vector<int> seam = findVerticalSeam(energy, ctx);
+
+		int64 start = getTickCount();
+		misses.start();
+		for (int r = 0; r < repeats; r++)
+			findVerticalSeam(energy, ctx);
+		misses.stop();
+		report(entry.name, secondsSince(start) / repeats, static_cast<double>(ctx.parentTableBytes(rows, cols)) / (1 << 20), seam == reference);
+	}
+	return mismatches == 0 ? 0 : 1;
+}
+
+// energy [image...] [repeats]: fused energy kernel against the OpenCV chain it replaces
+static int benchEnergy(int argc, char** argv) {
+	vector<string> paths;
+	int repeats = 20;
+	for (int a = 0; a < argc; a++) {
+		if (isdigit(static_cast<unsigned char>(argv[a][0])))
+			repeats = atoi(argv[a]);
+		else
+			paths.push_back(argv[a]);
+	}
+	if (paths.empty())
+		glob(SEAM_ASSETS_DIR "/*.jpg", paths);
+
+	cout << "energy: " << repeats << " repeats" << endl;
+	int failures = 0;
+	for (const string& path : paths) {
+		Mat img = imread(path);
+		if (img.empty()) {
+			cerr << "  cannot read " << path << endl;
+			failures++;
+			continue;
+		}
+
+		Mat reference = calculateEnergyMapOpenCV(img), fused;
+		computeEnergyMap(img, fused);
+		int mismatches = countNonZero(reference != fused);
+		failures += mismatches != 0;
+
+		int64 start = getTickCount();
+		for (int r = 0; r < repeats; r++)
+			reference = calculateEnergyMapOpenCV(img);
+		double chainTime = secondsSince(start) / repeats;
+
+		start = getTickCount();
+		for (int r = 0; r < repeats; r++)
+			computeEnergyMap(img, fused);
+		double fusedTime = secondsSince(start) / repeats;
+
+		double megapixels = img.total() / 1e6;
+		cout << "  " << path << " (" << img.cols << " x " << img.rows << ")" << endl
+			<< fixed << setprecision(3)
+			<< "    opencv chain " << setw(8) << chainTime * 1e3 << " ms  " << setprecision(1) << megapixels / chainTime << " MP/s" << endl
+			<< setprecision(3)
+			<< "    fused        " << setw(8) << fusedTime * 1e3 << " ms  " << setprecision(1) << megapixels / fusedTime << " MP/s"
+			<< setprecision(2) << "  x" << chainTime / fusedTime << endl
+			<< "    " << (mismatches == 0 ? "identical" : to_string(mismatches) + " pixels differ") << endl;
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+// Forward cost of removing seam from an image with this luma: the intensity differences between the
+// pixels that end up next to each other, the quantity forward energy minimizes
+static int64 insertedEnergy(const Mat& luma, const vector<int>& seam) {
+	int64 total = 0;
+	for (int i = 0; i < luma.rows; i++) {
+		const uchar* row = luma.ptr<uchar>(i);
+		int j = seam[i];
+		int l = row[max(j - 1, 0)], r = row[min(j + 1, luma.cols - 1)];
+		total += abs(r - l);
+		if (i > 0 && seam[i - 1] != j) {
+			// Stepping sideways also joins the pixel above with the one next to the seam
+			int u = luma.ptr<uchar>(i - 1)[j];
+			total += abs(u - (seam[i - 1] < j ? l : r));
+		}
+	}
+	return total;
+}
+
+// forward-energy [image] [seams]: backward against forward energy on one image, as the full table fill
+// the kernels do and as a whole retarget, with the intensity jumps each one's seams leave behind
+static int benchForwardEnergy(int argc, char** argv) {
+	int first;
+	string path;
+	Mat img = loadBenchImage(argc, argv, &first, &path);
+	if (img.empty())
+		return 1;
+	int seams = min(intArg(argc, argv, first, img.cols / 4), img.cols - 1);
+
+	cout << "forward-energy: " << path << " (" << img.cols << " x " << img.rows << "), " << seams << " vertical seams" << endl;
+
+	Mat energy, luma;
+	computeEnergyMap(img, energy);
+	computeLumaMap(img, luma);
+	vector<int> cost(img.total());
+	vector<schar> parent(img.total());
+	const int repeats = 20;
+
+	const struct {
+		const char* name;
+		SeamEnergy energy;
+	} variants[] = {
+		{ "backward", SeamEnergy::Backward },
+		{ "forward", SeamEnergy::Forward },
+	};
+
+	SeamCarver carver;
+	double backwardTime = 0;
+	for (const auto& variant : variants) {
+		bool forward = variant.energy == SeamEnergy::Forward;
+
+		int64 start = getTickCount();
+		for (int r = 0; r < repeats; r++) {
+			if (forward)
+				fillForwardCostTable(luma.data, luma.step, luma.rows, luma.cols, cost.data(), parent.data());
+			else
+				fillCostTable(energy.data, energy.step, energy.rows, energy.cols, cost.data(), parent.data());
+		}
+		double fillTime = secondsSince(start) / repeats;
+
+		Options options;
+		options.energy = variant.energy;
+		start = getTickCount();
+		carver.retarget(img, Size(img.cols - seams, img.rows), options);
+		double carveTime = secondsSince(start);
+		if (!forward)
+			backwardTime = carveTime;
+
+		// Second, untimed run to measure what each seam does to the image
+		int64 inserted = 0;
+		carver.setSeamCallback([&](const Mat& current, const vector<int>& seam, SeamDirection) {
+			Mat currentLuma;
+			computeLumaMap(current, currentLuma);
+			inserted += insertedEnergy(currentLuma, seam);
+		});
+		carver.retarget(img, Size(img.cols - seams, img.rows), options);
+		carver.setSeamCallback(nullptr);
+
+		cout << "  " << left << setw(9) << variant.name << right << fixed
+			<< setprecision(2) << "  fill " << setw(7) << fillTime * 1e9 / img.total() << " ns/cell"
+			<< setprecision(3) << "  carve " << setw(7) << carveTime * 1e3 / seams << " ms/seam"
+			<< setprecision(2) << "  x" << carveTime / backwardTime << " of backward"
+			<< "  inserted " << setprecision(1) << static_cast<double>(inserted) / seams << " per seam" << endl;
+	}
+	return 0;
+}
+
+// seam-batch [image] [seams]: seams taken per DP table against carve time and the energy the removed
+// seams carried, relative to one seam per table
+static int benchSeamBatch(int argc, char** argv) {
+	int first;
+	string path;
+	Mat img = loadBenchImage(argc, argv, &first, &path);
+	if (img.empty())
+		return 1;
+	int seams = min(intArg(argc, argv, first, img.cols / 4), img.cols - 1);
+
+	cout << "seam-batch: " << path << " (" << img.cols << " x " << img.rows << "), " << seams << " vertical seams" << endl;
+
+	SeamCarver carver;
+	double baseTime = 0, baseEnergy = 0;
+	for (int perPass : { 1, 2, 4, 8, 16, 32 }) {
+		Options options;
+		options.seamsPerPass = perPass;
+
+		int64 start = getTickCount();
+		carver.retarget(img, Size(img.cols - seams, img.rows), options);
+		double seconds = secondsSince(start);
+		double energy = static_cast<double>(carver.removedEnergy());
+		if (perPass == 1) {
+			baseTime = seconds;
+			baseEnergy = energy;
+		}
+
+		cout << "  k=" << left << setw(3) << perPass << right << fixed
+			<< setprecision(3) << "  " << setw(8) << seconds * 1e3 / seams << " ms/seam"
+			<< setprecision(2) << "  x" << setw(5) << baseTime / seconds << " faster"
+			<< "  energy removed " << setprecision(0) << setw(10) << energy
+			<< setprecision(3) << "  x" << energy / baseEnergy << " of one per table" << endl;
+	}
+	return 0;
+}
+
+// banded [image] [seams] [radius...]: band radius around the previous seam, with the optimality proof
+// ("exact") and with the heuristic checks ("approx"), against carve time, DP cells filled, how often the
+// band seam was kept, and the energy the removed seams carried, relative to the full DP. The cell and
+// band counters need a build with SEAM_ENABLE_PROFILING=1.
+static int benchBanded(int argc, char** argv) {
+	int first;
+	string path;
+	Mat img = loadBenchImage(argc, argv, &first, &path);
+	if (img.empty())
+		return 1;
+	int seams = min(intArg(argc, argv, first, img.cols / 4), img.cols - 1);
+	vector<int> radii = { 0, 4, 8, 16, 32, 64 };
+	if (argc > first + 1) {
+		radii.assign(1, 0);
+		for (int a = first + 1; a < argc; a++)
+			radii.push_back(atoi(argv[a]));
+	}
+
+	cout << "banded: " << path << " (" << img.cols << " x " << img.rows << "), " << seams << " vertical seams" << endl;
+
+	SeamCarver carver;
+	double baseTime = 0, baseEnergy = 0;
+	for (int radius : radii) {
+		for (bool exact : { true, false }) {
+			if (radius == 0 && !exact)
+				continue;
+			Options options;
+			options.bandRadius = radius;
+			options.bandExact = exact;
+
+			int64 start = getTickCount();
+			carver.retarget(img, Size(img.cols - seams, img.rows), options);
+			double seconds = secondsSince(start);
+			double energy = static_cast<double>(carver.removedEnergy());
+			const Profile& profile = carver.profile();
+			uint64_t banded = profile.count(Counter::BandedSeams);
+			uint64_t tried = banded + profile.count(Counter::BandFallbacks);
+			if (radius == 0) {
+				baseTime = seconds;
+				baseEnergy = energy;
+			}
+
+			cout << "  r=" << left << setw(3) << radius << " " << setw(6) << (radius == 0 ? "" : exact ? "exact" : "approx") << right << fixed
+				<< setprecision(3) << "  " << setw(8) << seconds * 1e3 / seams << " ms/seam"
+				<< setprecision(2) << "  x" << setw(5) << baseTime / seconds << " faster"
+				<< setprecision(0) << "  " << setw(9) << static_cast<double>(profile.count(Counter::DPCells)) / seams << " cells/seam"
+				<< setprecision(1) << "  band kept " << setw(5) << (tried ? 100.0 * banded / tried : 0.0) << "%"
+				<< setprecision(4) << "  energy x" << energy / baseEnergy << " of full DP" << endl;
+		}
+	}
+	return 0;
+}
+
+// pyramid [image] [seams]: coarse-to-fine seams against the exact DP seam of the same energy map, seam
+// by seam while the image is carved with the exact seams, then the time of a whole retarget
+static int benchPyramid(int argc, char** argv) {
+	int first;
+	string path;
+	Mat input = loadBenchImage(argc, argv, &first, &path);
+	if (input.empty())
+		return 1;
+	int seams = min(intArg(argc, argv, first, input.cols / 4), input.cols - 1);
+
+	cout << "pyramid: " << path << " (" << input.cols << " x " << input.rows << "), " << seams << " vertical seams" << endl;
+
+	const struct {
+		int levels, corridor;
+	} variants[] = { { 1, 4 }, { 2, 2 }, { 2, 4 }, { 2, 8 }, { 3, 4 }, { 4, 4 } };
+
+	SeamCarver carver;
+	Options exactOptions;
+	int64 start = getTickCount();
+	carver.retarget(input, Size(input.cols - seams, input.rows), exactOptions);
+	double exactRetarget = secondsSince(start);
+
+	for (const auto& variant : variants) {
+		Mat img = input.clone(), energy;
+		computeEnergyMap(img, energy);
+		SeamFinderContext exactCtx, pyramidCtx;
+		double exactTime = 0, pyramidTime = 0, ratioSum = 0, worst = 1;
+		int matched = 0;
+		for (int s = 0; s < seams; s++) {
+			start = getTickCount();
+			vector<int> exact = findVerticalSeam(energy, exactCtx);
+			exactTime += secondsSince(start);
+			start = getTickCount();
+			const vector<int>& coarse = findVerticalSeamPyramid(energy, pyramidCtx, variant.levels, variant.corridor);
+			pyramidTime += secondsSince(start);
+
+			int64_t exactCost = verticalSeamCost(energy, exact);
+			int64_t coarseCost = verticalSeamCost(energy, coarse);
+			double ratio = exactCost ? static_cast<double>(coarseCost) / exactCost : (coarseCost ? 2.0 : 1.0);
+			ratioSum += ratio;
+			worst = max(worst, ratio);
+			matched += coarseCost == exactCost;
+
+			removeVerticalSeamInPlace(img, exact);
+			updateEnergyAfterVerticalSeam(img, energy, exact);
+		}
+
+		Options options;
+		options.pyramidLevels = variant.levels;
+		options.pyramidCorridor = variant.corridor;
+		start = getTickCount();
+		carver.retarget(input, Size(input.cols - seams, input.rows), options);
+		double retargetTime = secondsSince(start);
+
+		cout << "  levels " << variant.levels << " corridor " << left << setw(2) << variant.corridor << right << fixed
+			<< setprecision(2) << "  find x" << setw(5) << exactTime / pyramidTime << " faster"
+			<< "  retarget x" << setw(5) << exactRetarget / retargetTime
+			<< setprecision(4) << "  cost x" << ratioSum / seams << " of exact (worst x" << worst << ")"
+			<< setprecision(1) << "  exact cost " << 100.0 * matched / seams << "%" << endl;
+	}
+	return 0;
+}
+
+// proxy [image] [percent]: seams planned on a downscaled proxy against the full-resolution carve, both
+// shrinking the image to percent of its size in each dimension. Quality is the mean Sobel energy left in
+// the result relative to the exact carve (content-aware carving keeps the high-energy pixels).
+static int benchProxy(int argc, char** argv) {
+	int first;
+	string path;
+	Mat img = loadBenchImage(argc, argv, &first, &path);
+	if (img.empty())
+		return 1;
+	int percent = min(max(intArg(argc, argv, first, 75), 1), 100);
+	Size target(max(img.cols * percent / 100, 1), max(img.rows * percent / 100, 1));
+
+	cout << "proxy: " << path << " (" << img.cols << " x " << img.rows << ") -> " << target.width << " x " << target.height << endl;
+
+	Mat energy;
+	SeamCarver carver;
+	int64 start = getTickCount();
+	Mat exact = carver.retarget(img, target, Options());
+	double exactTime = secondsSince(start);
+	computeEnergyMap(exact, energy);
+	double exactEnergy = mean(energy)[0];
+
+	for (double scale : { 1.0, 0.5, 0.25, 0.125 }) {
+		start = getTickCount();
+		Mat carved = retargetViaProxy(img, target, scale);
+		double seconds = secondsSince(start);
+		computeEnergyMap(carved, energy);
+
+		cout << "  scale " << fixed << setprecision(3) << scale << right
+			<< setprecision(1) << "  " << setw(8) << seconds * 1e3 << " ms"
+			<< setprecision(2) << "  x" << setw(6) << exactTime / seconds << " faster"
+			<< setprecision(3) << "  energy kept x" << mean(energy)[0] / exactEnergy << " of exact" << endl;
+	}
+	return 0;
+}
+
+// Random 8-connected seam across length lines of a span-wide image
+static vector<int> randomSeam(RNG& rng, int length, int span) {
+	vector<int> seam(length);
+	int p = rng.uniform(0, span);
+	for (int k = 0; k < length; k++) {
+		p = min(max(p + rng.uniform(-1, 2), 0), span - 1);
+		seam[k] = p;
+	}
+	return seam;
+}
+
+// removal [cols] [rows] [seams]: allocating removal against in-place removal, per direction
+static int benchRemoval(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 1920);
+	int rows = intArg(argc, argv, 1, 1080);
+	int seams = intArg(argc, argv, 2, 200);
+
+	Mat img(rows, cols, CV_8UC3);
+	randu(img, Scalar::all(0), Scalar::all(256));
+
+	cout << "removal: " << cols << " x " << rows << ", " << seams << " seams per direction" << endl;
+	int mismatches = 0;
+	for (bool vertical : { true, false }) {
+		int count = min(seams, (vertical ? cols : rows) - 1);
+
+		// Same seams for both variants
+		RNG rng(12345);
+		vector<vector<int>> paths;
+		for (int s = 0; s < count; s++)
+			paths.push_back(vertical ? randomSeam(rng, rows, cols - s) : randomSeam(rng, cols, rows - s));
+
+		Mat allocated = img;
+		int64 start = getTickCount();
+		for (const vector<int>& seam : paths)
+			allocated = vertical ? removeVerticalSeam(allocated, seam) : removeHorizontalSeam(allocated, seam);
+		double allocatingTime = secondsSince(start);
+
+		Mat work = img.clone();
+		start = getTickCount();
+		for (const vector<int>& seam : paths) {
+			if (vertical)
+				removeVerticalSeamInPlace(work, seam);
+			else
+				removeHorizontalSeamInPlace(work, seam);
+		}
+		Mat compact = work.clone();
+		double inPlaceTime = secondsSince(start);
+		bool same = countNonZero(allocated.reshape(1) != compact.reshape(1)) == 0;
+		mismatches += !same;
+
+		cout << "  " << (vertical ? "vertical  " : "horizontal")
+			<< fixed << setprecision(3)
+			<< "  allocating " << setw(8) << allocatingTime * 1e3 / count << " ms/seam"
+			<< "  in-place " << setw(8) << inPlaceTime * 1e3 / count << " ms/seam"
+			<< setprecision(2) << "  x" << allocatingTime / inPlaceTime
+			<< (same ? "" : "  MISMATCH") << endl;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
+
+// removal-parallel [cols] [rows] [seams]: in-place removal per parallel grain (0 = single-threaded) on
+// OpenCV's threads, against the single-threaded result, on an 8K frame by default
+static int benchRemovalParallel(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 7680);
+	int rows = intArg(argc, argv, 1, 4320);
+	int seams = intArg(argc, argv, 2, 50);
+
+	Mat img(rows, cols, CV_8UC3);
+	randu(img, Scalar::all(0), Scalar::all(256));
+	int savedGrain = getSeamParallelGrain();
+	int mismatches = 0;
+
+	cout << "removal-parallel: " << cols << " x " << rows << ", " << seams << " seams per direction, "
+		<< getNumThreads() << " threads" << endl;
+	for (bool vertical : { true, false }) {
+		int count = min(seams, (vertical ? cols : rows) - 1);
+		RNG rng(12345);
+		vector<vector<int>> paths;
+		for (int s = 0; s < count; s++)
+			paths.push_back(vertical ? randomSeam(rng, rows, cols - s) : randomSeam(rng, cols, rows - s));
+
+		Mat reference;
+		double serialTime = 0;
+		for (int grain : { 0, 1 << 20, 1 << 16, 1 << 14 }) {
+			setSeamParallelGrain(grain);
+			Mat work = img.clone();
+			int64 start = getTickCount();
+			for (const vector<int>& seam : paths) {
+				if (vertical)
+					removeVerticalSeamInPlace(work, seam);
+				else
+					removeHorizontalSeamInPlace(work, seam);
+			}
+			double seconds = secondsSince(start);
+			if (grain == 0) {
+				serialTime = seconds;
+				reference = work.clone();
+			}
+			bool same = countNonZero(work.clone().reshape(1) != reference.reshape(1)) == 0;
+			mismatches += !same;
+
+			cout << "  " << (vertical ? "vertical  " : "horizontal") << "  grain " << left << setw(8) << grain << right
+				<< fixed << setprecision(3) << "  " << setw(8) << seconds * 1e3 / count << " ms/seam"
+				<< setprecision(2) << "  x" << serialTime / seconds
+				<< (same ? "" : "  MISMATCH") << endl;
+		}
+	}
+	setSeamParallelGrain(savedGrain);
+	return mismatches == 0 ? 0 : 1;
+}
+
+// orientation [cols] [rows] [seams]: per-pixel cost of carving vertical seams out of a cols x rows image
+// against horizontal seams out of the rows x cols image, directly and through the transposed copy
+static int benchOrientation(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 1920);
+	int rows = intArg(argc, argv, 1, 1080);
+	int seams = min(intArg(argc, argv, 2, 100), min(cols, rows) - 1);
+
+	Mat wide(rows, cols, CV_8UC3);
+	randu(wide, Scalar::all(0), Scalar::all(256));
+	Mat tall = wide.t();
+
+	cout << "orientation: " << cols << " x " << rows << " (and transposed), " << seams << " seams" << endl;
+
+	const struct {
+		const char* name;
+		bool horizontal, transposeHorizontal;
+	} variants[] = {
+		{ "vertical", false, false },
+		{ "horizontal direct", true, false },
+		{ "horizontal transposed", true, true },
+	};
+
+	SeamCarver carver;
+	Mat reference;
+	double verticalCost = 0;
+	int mismatches = 0;
+	for (const auto& variant : variants) {
+		Options options;
+		options.transposeHorizontal = variant.transposeHorizontal;
+		const Mat& img = variant.horizontal ? tall : wide;
+		Size target = variant.horizontal ? Size(img.cols, img.rows - seams) : Size(img.cols - seams, img.rows);
+
+		int64 start = getTickCount();
+		Mat carved = carver.retarget(img, target, options);
+		double seconds = secondsSince(start);
+
+		// The same seams must come out of the transposed problem
+		if (variant.horizontal)
+			carved = carved.t();
+		if (reference.empty())
+			reference = carved;
+		bool same = countNonZero(reference.reshape(1) != carved.reshape(1)) == 0;
+		mismatches += !same;
+
+		// Pixels visited summed over all seams
+		double pixels = 0;
+		for (int s = 0; s < seams; s++)
+			pixels += static_cast<double>(rows) * (cols - s);
+		double cost = seconds * 1e9 / pixels;
+		if (!variant.horizontal)
+			verticalCost = cost;
+
+		cout << "  " << left << setw(22) << variant.name << right
+			<< fixed << setprecision(2)
+			<< "  " << setw(8) << seconds * 1e3 / seams << " ms/seam"
+			<< "  " << setw(6) << cost << " ns/pixel"
+			<< "  x" << cost / verticalCost << " of vertical"
+			<< (same ? "" : "  MISMATCH") << endl;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
+
+// planes [cols] [rows] [seams]: colour image plus alpha, mask and depth planes, one in-place removal per
+// plane against the fused multi-plane removal
+static int benchPlanes(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 1920);
+	int rows = intArg(argc, argv, 1, 1080);
+	int seams = min(intArg(argc, argv, 2, 200), cols - 1);
+
+	vector<Mat> planes = { Mat(rows, cols, CV_8UC3), Mat(rows, cols, CV_8UC1), Mat(rows, cols, CV_8UC1), Mat(rows, cols, CV_32FC1) };
+	for (Mat& plane : planes)
+		randu(plane, Scalar::all(0), Scalar::all(255));
+
+	RNG rng(12345);
+	vector<vector<int>> paths;
+	for (int s = 0; s < seams; s++)
+		paths.push_back(randomSeam(rng, rows, cols - s));
+
+	cout << "planes: " << cols << " x " << rows << ", 8UC3 + 8UC1 + 8UC1 + 32FC1, " << seams << " vertical seams" << endl;
+
+	vector<Mat> separate;
+	for (const Mat& plane : planes)
+		separate.push_back(plane.clone());
+	int64 start = getTickCount();
+	for (const vector<int>& seam : paths)
+		for (Mat& plane : separate)
+			removeVerticalSeamInPlace(plane, seam);
+	double separateTime = secondsSince(start);
+
+	vector<Mat> fused;
+	for (const Mat& plane : planes)
+		fused.push_back(plane.clone());
+	start = getTickCount();
+	for (const vector<int>& seam : paths)
+		removeVerticalSeamInPlace(fused, seam);
+	double fusedTime = secondsSince(start);
+
+	bool same = true;
+	for (size_t p = 0; p < planes.size(); p++)
+		same = same && countNonZero(separate[p].reshape(1) != fused[p].reshape(1)) == 0;
+
+	cout << fixed << setprecision(3)
+		<< "  per plane " << setw(8) << separateTime * 1e3 / seams << " ms/seam" << endl
+		<< "  fused     " << setw(8) << fusedTime * 1e3 / seams << " ms/seam"
+		<< setprecision(2) << "  x" << separateTime / fusedTime
+		<< (same ? "" : "  MISMATCH") << endl;
+	return same ? 0 : 1;
+}
+
+// index-map [cols] [rows] [seams]: one seam index map build against cutting widths out of it, and
+// against retargeting to each of those widths from scratch
+static int benchIndexMap(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 640);
+	int rows = intArg(argc, argv, 1, 480);
+	int seams = min(intArg(argc, argv, 2, 200), cols - 1);
+
+	Mat img(rows, cols, CV_8UC3);
+	randu(img, Scalar::all(0), Scalar::all(256));
+
+	cout << "index-map: " << cols << " x " << rows << ", " << seams << " vertical seams" << endl;
+
+	int64 start = getTickCount();
+	SeamIndexMap map = SeamIndexMap::build(img, cols - seams);
+	double buildTime = secondsSince(start);
+	cout << fixed << setprecision(2) << "  build   " << setw(9) << buildTime * 1e3 << " ms" << endl;
+
+	SeamCarver carver;
+	int mismatches = 0;
+	for (int step = 1; step <= 4; step++) {
+		int width = cols - seams * step / 4;
+
+		start = getTickCount();
+		Mat cut = map.apply(img, width);
+		double applyTime = secondsSince(start);
+
+		start = getTickCount();
+		Mat carved = carver.retarget(img, Size(width, rows));
+		double retargetTime = secondsSince(start);
+
+		bool same = countNonZero(cut.reshape(1) != carved.reshape(1)) == 0;
+		mismatches += !same;
+		cout << "  width " << setw(5) << width
+			<< "  apply " << setw(7) << applyTime * 1e3 << " ms"
+			<< "  retarget " << setw(9) << retargetTime * 1e3 << " ms"
+			<< "  x" << retargetTime / applyTime
+			<< (same ? "" : "  MISMATCH") << endl;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
+
+// index-file [cols] [rows] [seams]: sidecar size per encoding, and cutting the middle width straight
+// from the mapped file against the in-memory map
+static int benchIndexFile(int argc, char** argv) {
+	int cols = intArg(argc, argv, 0, 1920);
+	int rows = intArg(argc, argv, 1, 1080);
+	int seams = min(intArg(argc, argv, 2, 960), cols - 1);
+
+	Mat img(rows, cols, CV_8UC3);
+	randu(img, Scalar::all(0), Scalar::all(256));
+	SeamIndexMap map = SeamIndexMap::build(img, cols - seams);
+	SeamIndexKey key = seamIndexKey(img, Options());
+	int width = cols - seams / 2;
+	Mat reference = map.apply(img, width);
+
+	const int runs = 10;
+	int64 start = getTickCount();
+	for (int r = 0; r < runs; r++)
+		map.apply(img, width);
+	double memoryTime = secondsSince(start) / runs;
+
+	cout << "index-file: " << cols << " x " << rows << ", " << seams << " seams, cutting width " << width << endl;
+	cout << fixed << setprecision(3) << "  in memory   apply " << setw(8) << memoryTime * 1e3 << " ms" << endl;
+
+	const struct {
+		const char* name;
+		SeamIndexEncoding encoding;
+	} encodings[] = {
+		{ "raw", SeamIndexEncoding::Raw },
+		{ "delta-varint", SeamIndexEncoding::DeltaVarint },
+	};
+
+	string path = tempfile(".seamidx");
+	int mismatches = 0;
+	for (const auto& variant : encodings) {
+		if (!writeSeamIndexFile(path, map, key, variant.encoding)) {
+			cerr << "cannot write " << path << endl;
+			return 1;
+		}
+
+		start = getTickCount();
+		SeamIndexFile file;
+		bool opened = file.open(path);
+		double openTime = secondsSince(start);
+		if (!opened) {
+			cerr << file.error() << endl;
+			return 1;
+		}
+
+		start = getTickCount();
+		Mat cut;
+		for (int r = 0; r < runs; r++)
+			cut = file.apply(img, width);
+		double applyTime = secondsSince(start) / runs;
+		bool same = countNonZero(reference.reshape(1) != cut.reshape(1)) == 0;
+		mismatches += !same;
+
+		cout << "  " << left << setw(12) << variant.name << right
+			<< setprecision(2) << setw(8) << file.fileSize() / 1048576.0 << " MiB"
+			<< setprecision(3) << "  open " << setw(6) << openTime * 1e3 << " ms"
+			<< "  apply " << setw(8) << applyTime * 1e3 << " ms"
+			<< (same ? "" : "  MISMATCH") << endl;
+	}
+	remove(path.c_str());
+	return mismatches == 0 ? 0 : 1;
+}
+
+struct BenchmarkEntry {
+	const char* name;
+	int (*run)(int argc, char** argv);
+};
+
+static const BenchmarkEntry benchmarks[] = {
+	{ "dp-row", benchDPRow },
+	{ "dp-seam", benchDPSeam },
+	{ "dp-parallel", benchDPParallel },
+	{ "dp-tiled", benchDPTiled },
+	{ "energy", benchEnergy },
+	{ "removal", benchRemoval },
+	{ "removal-parallel", benchRemovalParallel },
+	{ "orientation", benchOrientation },
+	{ "planes", benchPlanes },
+	{ "index-map", benchIndexMap },
+	{ "index-file", benchIndexFile },
+	{ "forward-energy", benchForwardEnergy },
+	{ "seam-batch", benchSeamBatch },
+	{ "banded", benchBanded },
+	{ "pyramid", benchPyramid },
+	{ "proxy", benchProxy },
+};
+
+int runBenchmarks(int argc, char** argv) {
+	// Every benchmark runs even after one failed, the exit code reports whether any did
+	if (argc == 0) {
+		int failed = 0;
+		for (const BenchmarkEntry& bench : benchmarks)
+			if (bench.run(0, nullptr) != 0)
+				failed++;
+		return failed == 0 ? 0 : 1;
+	}
+
+	for (const BenchmarkEntry& bench : benchmarks)
+		if (strcmp(bench.name, argv[0]) == 0)
+			return bench.run(argc - 1, argv + 1);
+
+	cerr << "Unknown benchmark '" << argv[0] << "'. Available:";
+	for (const BenchmarkEntry& bench : benchmarks)
+		cerr << " " << bench.name;
+	cerr << endl;
+	return 1;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Microbenchmarks for the carving kernels, run as `SeamCarving --bench <name> [args...]`.
+// Without a name every benchmark runs with its default arguments. Benchmarks check their results
+// against a reference; the return value is non-zero when any check reports a MISMATCH (or an input
+// cannot be read), so a run can serve as a regression gate.
+int runBenchmarks(int argc, char** argv);
@@ -0,0 +1,554 @@
+#include "DPKernels.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SEAM_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// GCC and Clang need the ISA enabled per function, MSVC accepts the intrinsics anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define SEAM_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SEAM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SEAM_TARGET_SSE41
+#define SEAM_TARGET_AVX2
+#endif
+
+using namespace std;
+
+namespace seam {
+
+// Cost and parent for a single column, with the bounds checks of the original loop
+static inline void dpCell(const int* prev, const uchar* energy, int* cur, schar* parent, int cols, int j) {
+	int best = prev[j];
+	schar from = 0;
+
+	if (j > 0 && prev[j - 1] < best) {
+		best = prev[j - 1];
+		from = -1;
+	}
+	if (j < cols - 1 && prev[j + 1] < best) {
+		best = prev[j + 1];
+		from = 1;
+	}
+	cur[j] = best + energy[j];
+	parent[j] = from;
+}
+
+void dpRowScalar(const int* prev, const uchar* energy, int* cur, schar* parent, int cols, int begin, int end) {
+	for (int j = begin; j < end; j++)
+		dpCell(prev, energy, cur, parent, cols, j);
+}
+
+// Forward-energy cost and parent for a single column, borders replicated
+static inline void forwardCell(const int* prev, const uchar* above, const uchar* luma, int* cur, schar* parent, int cols, int j) {
+	int l = luma[max(j - 1, 0)], r = luma[min(j + 1, cols - 1)], u = above[j];
+	int up = abs(r - l);
+	int best = prev[j] + up;
+	schar from = 0;
+
+	if (j > 0 && prev[j - 1] + up + abs(u - l) < best) {
+		best = prev[j - 1] + up + abs(u - l);
+		from = -1;
+	}
+	if (j < cols - 1 && prev[j + 1] + up + abs(u - r) < best) {
+		best = prev[j + 1] + up + abs(u - r);
+		from = 1;
+	}
+	cur[j] = best;
+	parent[j] = from;
+}
+
+void forwardRowScalar(const int* prev, const uchar* above, const uchar* luma, int* cur, schar* parent, int cols, int begin, int end) {
+	for (int j = begin; j < end; j++)
+		forwardCell(prev, above, luma, cur, parent, cols, j);
+}
+
+void forwardFirstRow(const uchar* luma, int* cur, int cols, int begin, int end) {
+	for (int j = begin; j < end; j++)
+		cur[j] = abs(luma[min(j + 1, cols - 1)] - luma[max(j - 1, 0)]);
+}
+
+void packParentRow(const schar* parent, uchar* packed, int cols) {
+	int j = 0;
+	for (; j + 4 <= cols; j += 4)
+		packed[j >> 2] = static_cast<uchar>((parent[j] + 1) | ((parent[j + 1] + 1) << 2) |
+			((parent[j + 2] + 1) << 4) | ((parent[j + 3] + 1) << 6));
+	if (j < cols) {
+		uchar tail = 0;
+		for (int k = 0; j + k < cols; k++)
+			tail |= static_cast<uchar>((parent[j + k] + 1) << (2 * k));
+		packed[j >> 2] = tail;
+	}
+}
+
+#ifdef SEAM_HAVE_X86_KERNELS
+
+// The vector loops only cover interior columns so the left/right loads never leave the row;
+// column 0 and column cols - 1 go through dpCell.
+
+SEAM_TARGET_SSE41
+static void dpRowSSE41(const int* prev, const uchar* energy, int* cur, schar* parent, int cols, int begin, int end) {
+	int lo = max(begin, 1), hi = min(end, cols - 1);
+	if (lo >= hi) {
+		dpRowScalar(prev, energy, cur, parent, cols, begin, end);
+		return;
+	}
+	if (begin < lo)
+		dpCell(prev, energy, cur, parent, cols, begin);
+
+	const __m128i one = _mm_set1_epi32(1);
+	int j = lo;
+	for (; j + 4 <= hi; j += 4) {
+		__m128i centre = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j));
+		__m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j - 1));
+		__m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j + 1));
+
+		// Same strict comparisons as the scalar code so ties resolve identically.
+		// A true compare is all ones, which is already the -1 offset for "take left".
+		__m128i takeLeft = _mm_cmpgt_epi32(centre, left);
+		__m128i best = _mm_blendv_epi8(centre, left, takeLeft);
+		__m128i from = takeLeft;
+
+		__m128i takeRight = _mm_cmpgt_epi32(best, right);
+		best = _mm_blendv_epi8(best, right, takeRight);
+		from = _mm_blendv_epi8(from, one, takeRight);
+
+		int packed;
+		memcpy(&packed, energy + j, sizeof(packed));
+		__m128i e = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(cur + j), _mm_add_epi32(best, e));
+		int offsets = _mm_cvtsi128_si32(_mm_packs_epi16(_mm_packs_epi32(from, from), from));
+		memcpy(parent + j, &offsets, sizeof(offsets));
+	}
+	for (; j < hi; j++)
+		dpCell(prev, energy, cur, parent, cols, j);
+
+	if (end > hi)
+		dpCell(prev, energy, cur, parent, cols, hi);
+}
+
+SEAM_TARGET_AVX2
+static void dpRowAVX2(const int* prev, const uchar* energy, int* cur, schar* parent, int cols, int begin, int end) {
+	int lo = max(begin, 1), hi = min(end, cols - 1);
+	if (lo >= hi) {
+		dpRowScalar(prev, energy, cur, parent, cols, begin, end);
+		return;
+	}
+	if (begin < lo)
+		dpCell(prev, energy, cur, parent, cols, begin);
+
+	const __m256i one = _mm256_set1_epi32(1);
+	int j = lo;
+	for (; j + 8 <= hi; j += 8) {
+		__m256i centre = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j));
+		__m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j - 1));
+		__m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j + 1));
+
+		// Same strict comparisons as the scalar code so ties resolve identically.
+		// A true compare is all ones, which is already the -1 offset for "take left".
+		__m256i takeLeft = _mm256_cmpgt_epi32(centre, left);
+		__m256i best = _mm256_blendv_epi8(centre, left, takeLeft);
+		__m256i from = takeLeft;
+
+		__m256i takeRight = _mm256_cmpgt_epi32(best, right);
+		best = _mm256_blendv_epi8(best, right, takeRight);
+		from = _mm256_blendv_epi8(from, one, takeRight);
+
+		__m256i e = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(energy + j)));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(cur + j), _mm256_add_epi32(best, e));
+		__m128i from16 = _mm_packs_epi32(_mm256_castsi256_si128(from), _mm256_extracti128_si256(from, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(parent + j), _mm_packs_epi16(from16, from16));
+	}
+	for (; j < hi; j++)
+		dpCell(prev, energy, cur, parent, cols, j);
+
+	if (end > hi)
+		dpCell(prev, energy, cur, parent, cols, hi);
+}
+
+// Forward energy: the same min/blend structure, with the three step costs computed from the luma of
+// this row and the row above instead of one energy value added afterwards
+
+// 4 (8) bytes widened to 32-bit lanes
+SEAM_TARGET_SSE41
+static inline __m128i load4(const uchar* p) {
+	int packed;
+	memcpy(&packed, p, sizeof(packed));
+	return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+}
+
+SEAM_TARGET_AVX2
+static inline __m256i load8(const uchar* p) {
+	return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+SEAM_TARGET_SSE41
+static void forwardRowSSE41(const int* prev, const uchar* above, const uchar* luma, int* cur, schar* parent, int cols, int begin, int end) {
+	int lo = max(begin, 1), hi = min(end, cols - 1);
+	if (lo >= hi) {
+		forwardRowScalar(prev, above, luma, cur, parent, cols, begin, end);
+		return;
+	}
+	if (begin < lo)
+		forwardCell(prev, above, luma, cur, parent, cols, begin);
+
+	const __m128i one = _mm_set1_epi32(1);
+	int j = lo;
+	for (; j + 4 <= hi; j += 4) {
+		__m128i l = load4(luma + j - 1), r = load4(luma + j + 1), u = load4(above + j);
+		__m128i up = _mm_abs_epi32(_mm_sub_epi32(r, l));
+
+		__m128i centre = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j)), up);
+		__m128i left = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j - 1)),
+			_mm_add_epi32(up, _mm_abs_epi32(_mm_sub_epi32(u, l))));
+		__m128i right = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j + 1)),
+			_mm_add_epi32(up, _mm_abs_epi32(_mm_sub_epi32(u, r))));
+
+		__m128i takeLeft = _mm_cmpgt_epi32(centre, left);
+		__m128i best = _mm_blendv_epi8(centre, left, takeLeft);
+		__m128i from = takeLeft;
+
+		__m128i takeRight = _mm_cmpgt_epi32(best, right);
+		best = _mm_blendv_epi8(best, right, takeRight);
+		from = _mm_blendv_epi8(from, one, takeRight);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(cur + j), best);
+		int offsets = _mm_cvtsi128_si32(_mm_packs_epi16(_mm_packs_epi32(from, from), from));
+		memcpy(parent + j, &offsets, sizeof(offsets));
+	}
+	for (; j < hi; j++)
+		forwardCell(prev, above, luma, cur, parent, cols, j);
+
+	if (end > hi)
+		forwardCell(prev, above, luma, cur, parent, cols, hi);
+}
+
+SEAM_TARGET_AVX2
+static void forwardRowAVX2(const int* prev, const uchar* above, const uchar* luma, int* cur, schar* parent, int cols, int begin, int end) {
+	int lo = max(begin, 1), hi = min(end, cols - 1);
+	if (lo >= hi) {
+		forwardRowScalar(prev, above, luma, cur, parent, cols, begin, end);
+		return;
+	}
+	if (begin < lo)
+		forwardCell(prev, above, luma, cur, parent, cols, begin);
+
+	const __m256i one = _mm256_set1_epi32(1);
+	int j = lo;
+	for (; j + 8 <= hi; j += 8) {
+		__m256i l = load8(luma + j - 1), r = load8(luma + j + 1), u = load8(above + j);
+		__m256i up = _mm256_abs_epi32(_mm256_sub_epi32(r, l));
+
+		__m256i centre = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j)), up);
+		__m256i left = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j - 1)),
+			_mm256_add_epi32(up, _mm256_abs_epi32(_mm256_sub_epi32(u, l))));
+		__m256i right = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j + 1)),
+			_mm256_add_epi32(up, _mm256_abs_epi32(_mm256_sub_epi32(u, r))));
+
+		__m256i takeLeft = _mm256_cmpgt_epi32(centre, left);
+		__m256i best = _mm256_blendv_epi8(centre, left, takeLeft);
+		__m256i from = takeLeft;
+
+		__m256i takeRight = _mm256_cmpgt_epi32(best, right);
+		best = _mm256_blendv_epi8(best, right, takeRight);
+		from = _mm256_blendv_epi8(from, one, takeRight);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(cur + j), best);
+		__m128i from16 = _mm_packs_epi32(_mm256_castsi256_si128(from), _mm256_extracti128_si256(from, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(parent + j), _mm_packs_epi16(from16, from16));
+	}
+	for (; j < hi; j++)
+		forwardCell(prev, above, luma, cur, parent, cols, j);
+
+	if (end > hi)
+		forwardCell(prev, above, luma, cur, parent, cols, hi);
+}
+
+#endif // SEAM_HAVE_X86_KERNELS
+
+void fillCostTable(const uchar* energy, size_t energyStep, int rows, int cols, int* cost, schar* parent) {
+	for (int j = 0; j < cols; j++)
+		cost[j] = energy[j];
+
+	DPRowKernel fillRow = getDPRowKernel();
+	for (int i = 1; i < rows; i++) {
+		int* cur = cost + static_cast<size_t>(i) * cols;
+		fillRow(cur - cols, energy + i * energyStep, cur, parent + static_cast<size_t>(i) * cols, cols, 0, cols);
+	}
+}
+
+// Rows 1.. of a table whose first row is filled, in trapezoid blocks (see fillCostTableParallel);
+// fillRow(i, prev, cur, path, begin, end) computes columns [begin, end) of row i
+template <class FillRow>
+static void fillTableParallel(int rows, int cols, int* cost, schar* parent, int strips, int blockRows, FillRow fillRow) {
+	// Two private cost rows and a parent row per strip, all full width so columns index them directly
+	vector<int> privateCosts(static_cast<size_t>(strips) * 2 * cols);
+	vector<schar> privateParents(static_cast<size_t>(strips) * cols);
+
+	// Strip edges on 16-column boundaries, so no two threads write the same cache line of a row
+	auto edge = [&](int s) { return s == strips ? cols : (static_cast<int>(static_cast<int64_t>(s) * cols / strips) & ~15); };
+
+	for (int first = 1; first < rows; first += blockRows) {
+		int last = min(first + blockRows, rows) - 1;
+		cv::parallel_for_(cv::Range(0, strips), [&](const cv::Range& range) {
+			for (int s = range.start; s < range.end; s++) {
+				int a = edge(s), b = edge(s + 1);
+				int* rowPair[2] = { privateCosts.data() + static_cast<size_t>(s) * 2 * cols, privateCosts.data() + (static_cast<size_t>(s) * 2 + 1) * cols };
+				schar* path = privateParents.data() + static_cast<size_t>(s) * cols;
+				for (int i = first; i <= last; i++) {
+					int halo = last - i;
+					int begin = max(a - halo, 0), end = min(b + halo, cols);
+					const int* prev = i == first ? cost + static_cast<size_t>(i - 1) * cols : rowPair[(i - 1) & 1];
+					int* row = cost + static_cast<size_t>(i) * cols;
+					schar* rowParents = parent + static_cast<size_t>(i) * cols;
+
+					// The block's last row has no halo and goes straight into the table
+					if (halo == 0) {
+						fillRow(i, prev, row, rowParents, begin, end);
+						continue;
+					}
+					int* cur = rowPair[i & 1];
+					fillRow(i, prev, cur, path, begin, end);
+					copy(cur + a, cur + b, row + a);
+					copy(path + a, path + b, rowParents + a);
+				}
+			}
+		}, strips);
+	}
+}
+
+void fillCostTableParallel(const uchar* energy, size_t energyStep, int rows, int cols, int* cost, schar* parent, int strips, int blockRows) {
+	strips = min(strips, cols / 16);
+	if (strips < 2 || blockRows < 1) {
+		fillCostTable(energy, energyStep, rows, cols, cost, parent);
+		return;
+	}
+	for (int j = 0; j < cols; j++)
+		cost[j] = energy[j];
+
+	DPRowKernel kernel = getDPRowKernel();
+	fillTableParallel(rows, cols, cost, parent, strips, blockRows, [&](int i, const int* prev, int* cur, schar* path, int begin, int end) {
+		kernel(prev, energy + i * energyStep, cur, path, cols, begin, end);
+	});
+}
+
+void fillForwardCostTableParallel(const uchar* luma, size_t lumaStep, int rows, int cols, int* cost, schar* parent, int strips, int blockRows) {
+	strips = min(strips, cols / 16);
+	if (strips < 2 || blockRows < 1) {
+		fillForwardCostTable(luma, lumaStep, rows, cols, cost, parent);
+		return;
+	}
+	forwardFirstRow(luma, cost, cols, 0, cols);
+
+	ForwardRowKernel kernel = getForwardRowKernel();
+	fillTableParallel(rows, cols, cost, parent, strips, blockRows, [&](int i, const int* prev, int* cur, schar* path, int begin, int end) {
+		kernel(prev, luma + (i - 1) * lumaStep, luma + i * lumaStep, cur, path, cols, begin, end);
+	});
+}
+
+// Rows 1.. of a table whose first row is filled, in skewed tiles (see fillCostTableTiled). At row
+// first + t of a block a tile covers [a - t, a + tileCols - t), so the tiles of a row still partition it.
+template <class FillRow>
+static void fillTableTiled(int rows, int cols, int* cost, schar* parent, int tileCols, int blockRows, FillRow fillRow) {
+	blockRows = min(blockRows, tileCols);
+	for (int first = 1; first < rows; first += blockRows) {
+		int last = min(first + blockRows, rows) - 1;
+		for (int a = 0; a - (last - first) < cols; a += tileCols) {
+			for (int i = first; i <= last; i++) {
+				int t = i - first;
+				int begin = max(a - t, 0), end = min(a + tileCols - t, cols);
+				if (begin < end)
+					fillRow(i, cost + static_cast<size_t>(i - 1) * cols, cost + static_cast<size_t>(i) * cols, parent + static_cast<size_t>(i) * cols, begin, end);
+			}
+		}
+	}
+}
+
+void fillCostTableTiled(const uchar* energy, size_t energyStep, int rows, int cols, int* cost, schar* parent, int tileCols, int blockRows) {
+	if (tileCols < 2 || blockRows < 2 || tileCols >= cols) {
+		fillCostTable(energy, energyStep, rows, cols, cost, parent);
+		return;
+	}
+	for (int j = 0; j < cols; j++)
+		cost[j] = energy[j];
+
+	DPRowKernel kernel = getDPRowKernel();
+	fillTableTiled(rows, cols, cost, parent, tileCols, blockRows, [&](int i, const int* prev, int* cur, schar* path, int begin, int end) {
+		kernel(prev, energy + i * energyStep, cur, path, cols, begin, end);
+	});
+}
+
+void fillForwardCostTableTiled(const uchar* luma, size_t lumaStep, int rows, int cols, int* cost, schar* parent, int tileCols, int blockRows) {
+	if (tileCols < 2 || blockRows < 2 || tileCols >= cols) {
+		fillForwardCostTable(luma, lumaStep, rows, cols, cost, parent);
+		return;
+	}
+	forwardFirstRow(luma, cost, cols, 0, cols);
+
+	ForwardRowKernel kernel = getForwardRowKernel();
+	fillTableTiled(rows, cols, cost, parent, tileCols, blockRows, [&](int i, const int* prev, int* cur, schar* path, int begin, int end) {
+		kernel(prev, luma + (i - 1) * lumaStep, luma + i * lumaStep, cur, path, cols, begin, end);
+	});
+}
+
+// Columns [lo, hi] of row i that may differ after removing seam; lo/hi carry the previous row's span in
+static inline void coneSpan(const int* seam, int rows, int cols, int i, int& lo, int& hi) {
+	// Energy band around the seam (see updateEnergyAfterVerticalSeam). It also covers the cells whose
+	// three predecessors straddle the seam in the row above.
+	int first = seam[i], last = seam[i];
+	for (int k = max(i - 1, 0); k <= min(i + 1, rows - 1); k++) {
+		first = min(first, seam[k]);
+		last = max(last, seam[k]);
+	}
+
+	if (i == 0) {
+		lo = first - 1;
+		hi = last;
+	}
+	else {
+		lo = min(first - 1, lo - 1);
+		hi = max(last, hi + 1);
+	}
+	lo = max(lo, 0);
+	hi = min(hi, cols - 1);
+}
+
+size_t costTableConeCells(int rows, int cols, const int* seam) {
+	size_t cells = 0;
+	int lo = 0, hi = 0;
+	for (int i = 0; i < rows; i++) {
+		coneSpan(seam, rows, cols, i, lo, hi);
+		cells += hi - lo + 1;
+	}
+	return cells;
+}
+
+void fillForwardCostTable(const uchar* luma, size_t lumaStep, int rows, int cols, int* cost, schar* parent) {
+	forwardFirstRow(luma, cost, cols, 0, cols);
+
+	ForwardRowKernel fillRow = getForwardRowKernel();
+	for (int i = 1; i < rows; i++) {
+		int* cur = cost + static_cast<size_t>(i) * cols;
+		fillRow(cur - cols, luma + (i - 1) * lumaStep, luma + i * lumaStep, cur, parent + static_cast<size_t>(i) * cols, cols, 0, cols);
+	}
+}
+
+// The incremental update shared by both energies: firstRow(cur, begin, end) and
+// fillRow(i, cur, path, begin, end) recompute a span of row i
+template <class FirstRow, class FillRow>
+static void updateTable(int rows, int cols, const int* seam, int* cost, schar* parent, FirstRow firstRow, FillRow fillRow) {
+	size_t oldCols = static_cast<size_t>(cols) + 1;
+	int lo = 0, hi = 0;
+	bool wholeRows = false;
+
+	for (int i = 0; i < rows; i++) {
+		int* cur = cost + static_cast<size_t>(i) * cols;
+		schar* path = parent + static_cast<size_t>(i) * cols;
+		coneSpan(seam, rows, cols, i, lo, hi);
+
+		// Close the gap left by the seam. New rows start at or before the old ones, so walking down
+		// the table never overwrites a row that is still to be read. Once the cone spans the whole
+		// width every later row is recomputed anyway and the old values are not needed.
+		if (!wholeRows) {
+			const int* oldCost = cost + i * oldCols;
+			const schar* oldPath = parent + i * oldCols;
+			int s = seam[i];
+			memmove(cur, oldCost, s * sizeof(int));
+			memmove(cur + s, oldCost + s + 1, (cols - s) * sizeof(int));
+			memmove(path, oldPath, s);
+			memmove(path + s, oldPath + s + 1, cols - s);
+			wholeRows = lo == 0 && hi == cols - 1;
+		}
+
+		if (i == 0)
+			firstRow(cur, lo, hi + 1);
+		else
+			fillRow(i, cur, path, lo, hi + 1);
+	}
+}
+
+void updateCostTable(const uchar* energy, size_t energyStep, int rows, int cols, const int* seam, int* cost, schar* parent) {
+	DPRowKernel kernel = getDPRowKernel();
+	updateTable(rows, cols, seam, cost, parent,
+		[&](int* cur, int begin, int end) { copy(energy + begin, energy + end, cur + begin); },
+		[&](int i, int* cur, schar* path, int begin, int end) { kernel(cur - cols, energy + i * energyStep, cur, path, cols, begin, end); });
+}
+
+void updateForwardCostTable(const uchar* luma, size_t lumaStep, int rows, int cols, const int* seam, int* cost, schar* parent) {
+	ForwardRowKernel kernel = getForwardRowKernel();
+	updateTable(rows, cols, seam, cost, parent,
+		[&](int* cur, int begin, int end) { forwardFirstRow(luma, cur, cols, begin, end); },
+		[&](int i, int* cur, schar* path, int begin, int end) {
+			kernel(cur - cols, luma + (i - 1) * lumaStep, luma + i * lumaStep, cur, path, cols, begin, end);
+		});
+}
+
+int getDPRowKernels(DPRowKernelInfo* kernels, int maxKernels) {
+	DPRowKernelInfo all[] = {
+		{ "scalar", dpRowScalar },
+#ifdef SEAM_HAVE_X86_KERNELS
+		{ "sse4.1", cv::checkHardwareSupport(CV_CPU_SSE4_1) ? dpRowSSE41 : nullptr },
+		{ "avx2", cv::checkHardwareSupport(CV_CPU_AVX2) ? dpRowAVX2 : nullptr },
+#endif
+	};
+	int count = min(maxKernels, static_cast<int>(sizeof(all) / sizeof(all[0])));
+	copy(all, all + count, kernels);
+	return count;
+}
+
+// Last supported entry of getDPRowKernels is the widest one
+static const DPRowKernelInfo& selectedDPRowKernel() {
+	static const DPRowKernelInfo selected = [] {
+		DPRowKernelInfo kernels[8];
+		int count = getDPRowKernels(kernels, 8);
+		DPRowKernelInfo best = kernels[0];
+		for (int k = 1; k < count; k++)
+			if (kernels[k].kernel)
+				best = kernels[k];
+		return best;
+	}();
+	return selected;
+}
+
+DPRowKernel getDPRowKernel() {
+	return selectedDPRowKernel().kernel;
+}
+
+const char* getDPRowKernelName() {
+	return selectedDPRowKernel().name;
+}
+
+int getForwardRowKernels(ForwardRowKernelInfo* kernels, int maxKernels) {
+	ForwardRowKernelInfo all[] = {
+		{ "scalar", forwardRowScalar },
+#ifdef SEAM_HAVE_X86_KERNELS
+		{ "sse4.1", cv::checkHardwareSupport(CV_CPU_SSE4_1) ? forwardRowSSE41 : nullptr },
+		{ "avx2", cv::checkHardwareSupport(CV_CPU_AVX2) ? forwardRowAVX2 : nullptr },
+#endif
+	};
+	int count = min(maxKernels, static_cast<int>(sizeof(all) / sizeof(all[0])));
+	copy(all, all + count, kernels);
+	return count;
+}
+
+ForwardRowKernel getForwardRowKernel() {
+	static const ForwardRowKernel selected = [] {
+		ForwardRowKernelInfo kernels[8];
+		int count = getForwardRowKernels(kernels, 8);
+		ForwardRowKernel best = kernels[0].kernel;
+		for (int k = 1; k < count; k++)
+			if (kernels[k].kernel)
+				best = kernels[k].kernel;
+		return best;
+	}();
+	return selected;
+}
+
+} // namespace seam
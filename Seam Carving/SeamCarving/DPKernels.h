@@ -0,0 +1,93 @@
+#pragma once
+#include <opencv2/core.hpp>
+
+namespace seam {
+
+// One row of the vertical seam DP over the columns [begin, end) of a row that is cols wide:
+//   cur[j] = energy[j] + min(prev[j - 1], prev[j], prev[j + 1])
+//   parent[j] = offset of the chosen predecessor column relative to j (-1, 0 or +1)
+// Ties go to the centre, then the left neighbour, exactly like the scalar loop in findVerticalSeam.
+typedef void (*DPRowKernel)(const int* prev, const uchar* energy, int* cur, schar* parent, int cols, int begin, int end);
+
+// Portable reference version
+void dpRowScalar(const int* prev, const uchar* energy, int* cur, schar* parent, int cols, int begin, int end);
+
+// Fastest kernel supported by the running CPU (AVX2, SSE4.1 or scalar), picked once on first use
+DPRowKernel getDPRowKernel();
+const char* getDPRowKernelName();
+
+// Every kernel compiled into this build together with its name, for benchmarks and verification.
+// Kernels the running CPU cannot execute are reported as nullptr.
+struct DPRowKernelInfo {
+	const char* name;
+	DPRowKernel kernel;
+};
+int getDPRowKernels(DPRowKernelInfo* kernels, int maxKernels);
+
+// One row of the forward-energy DP (Rubinstein, Shamir & Avidan 2008) over the columns [begin, end).
+// Instead of the energy of the removed pixel, a step costs the luma differences between the pixels
+// that become neighbours once it is gone (l, r: left and right neighbour in this row, u: the pixel above,
+// borders replicated):
+//   up = |r - l|,  left = up + |u - l|,  right = up + |u - r|
+//   cur[j] = min(prev[j - 1] + left, prev[j] + up, prev[j + 1] + right)
+// Parents and ties work exactly like DPRowKernel.
+typedef void (*ForwardRowKernel)(const int* prev, const uchar* above, const uchar* luma, int* cur, schar* parent, int cols, int begin, int end);
+
+void forwardRowScalar(const int* prev, const uchar* above, const uchar* luma, int* cur, schar* parent, int cols, int begin, int end);
+
+ForwardRowKernel getForwardRowKernel();
+
+struct ForwardRowKernelInfo {
+	const char* name;
+	ForwardRowKernel kernel;
+};
+int getForwardRowKernels(ForwardRowKernelInfo* kernels, int maxKernels);
+
+// First row of the forward-energy table: cur[j] = |r - l|
+void forwardFirstRow(const uchar* luma, int* cur, int cols, int begin, int end);
+
+// 2-bit packed parent rows: four offsets per byte, stored as offset + 1 in bits 2 * (j % 4)
+inline size_t packedParentStride(int cols) {
+	return (static_cast<size_t>(cols) + 3) / 4;
+}
+
+void packParentRow(const schar* parent, uchar* packed, int cols);
+
+inline int unpackParent(const uchar* packed, int j) {
+	return ((packed[j >> 2] >> ((j & 3) * 2)) & 3) - 1;
+}
+
+// Whole vertical DP table (rows x cols, one contiguous block each) from an 8-bit energy map
+void fillCostTable(const uchar* energy, size_t energyStep, int rows, int cols, int* cost, schar* parent);
+
+// Incremental DP. cost/parent hold the table of a map one column wider, from which seam (in the old
+// columns) has since been removed and whose energy changed only in the band updateEnergyAfterVerticalSeam
+// repaints. Only a cell whose energy changed, or whose predecessors did, can change, so the work is a
+// cone that starts at the seam's energy band and widens by one column per row. The table is compacted
+// to rows x cols in place and the cone recomputed; the result equals fillCostTable on the new energy.
+void updateCostTable(const uchar* energy, size_t energyStep, int rows, int cols, const int* seam, int* cost, schar* parent);
+
+// Forward-energy versions of the two, on an 8-bit luma map. Removing a seam changes the step costs only
+// next to it, inside the same cone, so the incremental update works the same way.
+void fillForwardCostTable(const uchar* luma, size_t lumaStep, int rows, int cols, int* cost, schar* parent);
+void updateForwardCostTable(const uchar* luma, size_t lumaStep, int rows, int cols, const int* seam, int* cost, schar* parent);
+
+// The same two tables filled on several threads (cv::parallel_for_), identical to the serial fills.
+// Rows go in blocks of blockRows and each of strips threads owns a strip of columns. Within a block a
+// strip also computes, in private rows, the cells to either side that its own cells depend on: a
+// trapezoid one column wider per side for every row above the block's last, so the threads only
+// meet once per block instead of once per row.
+void fillCostTableParallel(const uchar* energy, size_t energyStep, int rows, int cols, int* cost, schar* parent, int strips, int blockRows);
+void fillForwardCostTableParallel(const uchar* luma, size_t lumaStep, int rows, int cols, int* cost, schar* parent, int strips, int blockRows);
+
+// The same two tables on the calling thread, tiled for cache reuse: rows go in blocks of blockRows and
+// each block is swept left to right in tiles of tileCols columns that lean one column to the left per
+// row, so every cell's three predecessors are done before it without any recomputation, and the row
+// segment a tile reads was written a moment ago and is still in L1. Identical to the row-by-row fill.
+void fillCostTableTiled(const uchar* energy, size_t energyStep, int rows, int cols, int* cost, schar* parent, int tileCols, int blockRows);
+void fillForwardCostTableTiled(const uchar* luma, size_t lumaStep, int rows, int cols, int* cost, schar* parent, int tileCols, int blockRows);
+
+// Number of cells updateCostTable would recompute, to decide whether a full fill is cheaper
+size_t costTableConeCells(int rows, int cols, const int* seam);
+
+} // namespace seam
@@ -0,0 +1,342 @@
+#include "Energy.h"
+#include "SeamCarving.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+using namespace cv;
+using namespace std;
+
+namespace seam {
+
+// Fixed-point BGR -> gray weights used by cvtColor for 8-bit images (0.114, 0.587, 0.299 in Q14)
+static const int B2Y = 1868, G2Y = 9617, R2Y = 4899, YShift = 14;
+
+// Columns processed per tile, so the three luma rows of a tile stay in L1
+static const int EnergyTileWidth = 2048;
+
+// BORDER_REFLECT_101, the default border of Sobel
+static inline int reflect101(int p, int len) {
+	if (len == 1)
+		return 0;
+	if (p < 0)
+		return -p;
+	if (p >= len)
+		return 2 * len - 2 - p;
+	return p;
+}
+
+static inline short lumaPixel(const uchar* px) {
+	return static_cast<short>((px[0] * B2Y + px[1] * G2Y + px[2] * R2Y + (1 << (YShift - 1))) >> YShift);
+}
+
+// How each supported depth turns a pixel into luma and a luma gradient into an 8-bit magnitude.
+// Gray images are their own luma. Energy is always 8-bit, on the scale of the 8-bit kernel.
+template <typename T>
+struct EnergyTraits;
+
+template <>
+struct EnergyTraits<uchar> {
+	typedef short Luma;
+	static Luma luma(const uchar* px, int cn) { return cn == 1 ? px[0] : lumaPixel(px); }
+	static int magnitude(int g) { return min(abs(g), 255); }
+	static uchar byte(Luma y) { return saturate_cast<uchar>(y); }
+};
+
+template <>
+struct EnergyTraits<ushort> {
+	typedef int Luma;
+	static Luma luma(const ushort* px, int cn) {
+		return cn == 1 ? px[0] : (px[0] * B2Y + px[1] * G2Y + px[2] * R2Y + (1 << (YShift - 1))) >> YShift;
+	}
+	// The 16-bit value v * 257 stands for the 8-bit value v
+	static int magnitude(int g) { return min((abs(g) + 128) / 257, 255); }
+	static uchar byte(Luma y) { return static_cast<uchar>((y + 128) / 257); }
+};
+
+template <>
+struct EnergyTraits<float> {
+	typedef float Luma;
+	static Luma luma(const float* px, int cn) { return cn == 1 ? px[0] : px[0] * 0.114f + px[1] * 0.587f + px[2] * 0.299f; }
+	// Float images are taken to be in [0, 1]
+	static int magnitude(float g) { return cvRound(min(std::fabs(g), 1.f) * 255); }
+	static uchar byte(Luma y) { return static_cast<uchar>(cvRound(min(max(y, 0.f), 1.f) * 255)); }
+};
+
+// Luma of count contiguous pixels starting at bgr
+static void lumaSpan(const uchar* bgr, int cn, short* out, int count) {
+	int x = 0;
+#if CV_SIMD
+	const int lanes = VTraits<v_uint8>::vlanes();
+	const v_uint32 wb = vx_setall_u32(B2Y), wg = vx_setall_u32(G2Y), wr = vx_setall_u32(R2Y);
+	const v_uint32 half = vx_setall_u32(1 << (YShift - 1));
+
+	auto weigh = [&](const v_uint16& b, const v_uint16& g, const v_uint16& r) {
+		v_uint32 b0, b1, g0, g1, r0, r1;
+		v_expand(b, b0, b1);
+		v_expand(g, g0, g1);
+		v_expand(r, r0, r1);
+		v_uint32 y0 = v_shr<YShift>(v_add(v_add(v_mul(b0, wb), v_mul(g0, wg)), v_add(v_mul(r0, wr), half)));
+		v_uint32 y1 = v_shr<YShift>(v_add(v_add(v_mul(b1, wb), v_mul(g1, wg)), v_add(v_mul(r1, wr), half)));
+		return v_reinterpret_as_s16(v_pack(y0, y1));
+	};
+
+	for (; x + lanes <= count; x += lanes) {
+		v_uint8 b, g, r, a;
+		if (cn == 3)
+			v_load_deinterleave(bgr + x * 3, b, g, r);
+		else
+			v_load_deinterleave(bgr + x * 4, b, g, r, a);
+
+		v_uint16 b0, b1, g0, g1, r0, r1;
+		v_expand(b, b0, b1);
+		v_expand(g, g0, g1);
+		v_expand(r, r0, r1);
+		v_store(out + x, weigh(b0, g0, r0));
+		v_store(out + x + lanes / 2, weigh(b1, g1, r1));
+	}
+#endif
+	for (; x < count; x++)
+		out[x] = lumaPixel(bgr + x * cn);
+}
+
+// Any other depth or channel count, left to the compiler to vectorize
+template <typename T>
+static void lumaSpan(const T* px, int cn, typename EnergyTraits<T>::Luma* out, int count) {
+	if constexpr (is_same_v<T, uchar>) {
+		if (cn != 1) {
+			lumaSpan(px, cn, out, count);
+			return;
+		}
+	}
+	if (cn == 1)
+		copy(px, px + count, out);
+	else
+		for (int x = 0; x < count; x++)
+			out[x] = EnergyTraits<T>::luma(px + x * cn, cn);
+}
+
+// Luma of row y for the columns x0 - 1 .. x0 + width, with reflected borders
+template <typename T>
+static void lumaRow(const Mat& img, int y, int x0, int width, typename EnergyTraits<T>::Luma* out) {
+	const T* row = img.ptr<T>(reflect101(y, img.rows));
+	int cn = img.channels();
+
+	// Interior part in one contiguous run, the (at most two) reflected columns separately
+	int first = max(x0 - 1, 0), last = min(x0 + width + 1, img.cols);
+	lumaSpan<T>(row + first * cn, cn, out + (first - (x0 - 1)), last - first);
+	if (x0 - 1 < 0)
+		out[0] = EnergyTraits<T>::luma(row + reflect101(x0 - 1, img.cols) * cn, cn);
+	if (x0 + width + 1 > img.cols)
+		out[width + 1] = EnergyTraits<T>::luma(row + reflect101(x0 + width, img.cols) * cn, cn);
+}
+
+// 3x3 Sobel on three luma rows, absolute values saturated to 8 bits and averaged with
+// round-half-to-even, which is what addWeighted(…, 0.5, …, 0.5, 0) does in floating point
+static void energySpan(const short* above, const short* centre, const short* below, uchar* out, int width) {
+	int x = 0;
+#if CV_SIMD
+	const int lanes = VTraits<v_int16>::vlanes();
+	const v_uint16 maxByte = vx_setall_u16(255), one = vx_setall_u16(1);
+	for (; x + lanes <= width; x += lanes) {
+		v_int16 a0 = vx_load(above + x), a1 = vx_load(above + x + 1), a2 = vx_load(above + x + 2);
+		v_int16 c0 = vx_load(centre + x), c2 = vx_load(centre + x + 2);
+		v_int16 b0 = vx_load(below + x), b1 = vx_load(below + x + 1), b2 = vx_load(below + x + 2);
+
+		v_int16 gx = v_add(v_add(v_sub(a2, a0), v_sub(b2, b0)), v_shl<1>(v_sub(c2, c0)));
+		v_int16 gy = v_sub(v_add(v_add(b0, b2), v_shl<1>(b1)), v_add(v_add(a0, a2), v_shl<1>(a1)));
+
+		v_uint16 sum = v_add(v_min(v_abs(gx), maxByte), v_min(v_abs(gy), maxByte));
+		v_uint16 energy = v_shr<1>(v_add(sum, v_and(v_shr<1>(sum), one)));
+		v_pack_store(out + x, energy);
+	}
+#endif
+	for (; x < width; x++) {
+		int gx = (above[x + 2] - above[x]) + 2 * (centre[x + 2] - centre[x]) + (below[x + 2] - below[x]);
+		int gy = (below[x] + 2 * below[x + 1] + below[x + 2]) - (above[x] + 2 * above[x + 1] + above[x + 2]);
+		int sum = min(abs(gx), 255) + min(abs(gy), 255);
+		out[x] = static_cast<uchar>((sum + ((sum >> 1) & 1)) >> 1);
+	}
+}
+
+// Same Sobel for 16-bit and float luma, each magnitude scaled to 8 bits by the depth's traits
+template <typename T>
+static void energySpan(const typename EnergyTraits<T>::Luma* above, const typename EnergyTraits<T>::Luma* centre,
+	const typename EnergyTraits<T>::Luma* below, uchar* out, int width) {
+	if constexpr (is_same_v<T, uchar>) {
+		energySpan(above, centre, below, out, width);
+	}
+	else {
+		for (int x = 0; x < width; x++) {
+			auto gx = (above[x + 2] - above[x]) + 2 * (centre[x + 2] - centre[x]) + (below[x + 2] - below[x]);
+			auto gy = (below[x] + 2 * below[x + 1] + below[x + 2]) - (above[x] + 2 * above[x + 1] + above[x + 2]);
+			int sum = EnergyTraits<T>::magnitude(gx) + EnergyTraits<T>::magnitude(gy);
+			out[x] = static_cast<uchar>((sum + ((sum >> 1) & 1)) >> 1);
+		}
+	}
+}
+
+// One column tile: walks the rows once, computing each luma row exactly once
+template <typename T>
+static void energyTile(const Mat& img, Mat& energyMap, int y0, int y1, int x0, int width) {
+	typedef typename EnergyTraits<T>::Luma Luma;
+
+	// Padded so the vector loads at x + 2 stay inside the buffer
+	int stride = width + 2 + 32;
+	AutoBuffer<Luma> ring(stride * 3);
+	Luma* rows[3] = { ring.data(), ring.data() + stride, ring.data() + 2 * stride };
+
+	lumaRow<T>(img, y0 - 1, x0, width, rows[0]);
+	lumaRow<T>(img, y0, x0, width, rows[1]);
+	for (int y = y0; y < y1; y++) {
+		lumaRow<T>(img, y + 1, x0, width, rows[2]);
+		energySpan<T>(rows[0], rows[1], rows[2], energyMap.ptr<uchar>(y) + x0, width);
+		rotate(rows, rows + 1, rows + 3);
+	}
+}
+
+template <typename T>
+static void energyRegion(const Mat& img, Mat& energyMap, const Rect& r) {
+	for (int x0 = r.x; x0 < r.x + r.width; x0 += EnergyTileWidth)
+		energyTile<T>(img, energyMap, r.y, r.y + r.height, x0, min(EnergyTileWidth, r.x + r.width - x0));
+}
+
+bool fusedEnergySupported(int type) {
+	int depth = CV_MAT_DEPTH(type), cn = CV_MAT_CN(type);
+	return (depth == CV_8U || depth == CV_16U || depth == CV_32F) && (cn == 1 || cn == 3 || cn == 4);
+}
+
+void computeEnergyRegion(const Mat& img, Mat& energyMap, const Rect& region) {
+	CV_Assert(fusedEnergySupported(img.type()));
+	CV_Assert(energyMap.type() == CV_8UC1 && energyMap.size() == img.size());
+
+	Rect r = region & Rect(0, 0, img.cols, img.rows);
+	switch (img.depth()) {
+	case CV_8U: energyRegion<uchar>(img, energyMap, r); break;
+	case CV_16U: energyRegion<ushort>(img, energyMap, r); break;
+	case CV_32F: energyRegion<float>(img, energyMap, r); break;
+	}
+}
+
+void computeEnergyMap(const Mat& img, Mat& energyMap) {
+	energyMap.create(img.size(), CV_8UC1);
+	computeEnergyRegion(img, energyMap, Rect(0, 0, img.cols, img.rows));
+}
+
+template <typename T>
+static void lumaMap(const Mat& img, Mat& luma) {
+	AutoBuffer<typename EnergyTraits<T>::Luma> row(img.cols);
+	for (int i = 0; i < img.rows; i++) {
+		lumaSpan<T>(img.ptr<T>(i), img.channels(), row.data(), img.cols);
+		uchar* out = luma.ptr<uchar>(i);
+		for (int j = 0; j < img.cols; j++)
+			out[j] = EnergyTraits<T>::byte(row[j]);
+	}
+}
+
+void computeLumaMap(const Mat& img, Mat& luma) {
+	if (!fusedEnergySupported(img.type())) {
+		Mat gray;
+		if (img.channels() >= 3)
+			cvtColor(img, gray, img.channels() == 3 ? COLOR_BGR2GRAY : COLOR_BGRA2GRAY);
+		else
+			extractChannel(img, gray, 0);
+		gray.convertTo(luma, CV_8U, img.depth() == CV_64F ? 255 : 1);
+		return;
+	}
+
+	luma.create(img.size(), CV_8UC1);
+	switch (img.depth()) {
+	case CV_8U: lumaMap<uchar>(img, luma); break;
+	case CV_16U: lumaMap<ushort>(img, luma); break;
+	case CV_32F: lumaMap<float>(img, luma); break;
+	}
+}
+
+// Smallest and largest seam position over the lines next to line k (the Sobel footprint)
+static inline void seamSpread(const vector<int>& seam, int k, int& lo, int& hi) {
+	int last = static_cast<int>(seam.size()) - 1;
+	lo = hi = seam[k];
+	if (k > 0) {
+		lo = min(lo, seam[k - 1]);
+		hi = max(hi, seam[k - 1]);
+	}
+	if (k < last) {
+		lo = min(lo, seam[k + 1]);
+		hi = max(hi, seam[k + 1]);
+	}
+}
+
+// A pixel keeps its energy when its whole 3x3 neighbourhood shifted together with it, i.e. when it
+// sits at least two columns left of, or one column right of, the seam in all three rows it reads.
+// That leaves the columns [min - 1, max] of the nearby seam positions to recompute.
+void updateEnergyAfterVerticalSeam(const Mat& img, Mat& energyMap, const vector<int>& seam, int threads) {
+	CV_Assert(energyMap.rows == img.rows && energyMap.cols == img.cols + 1);
+	removeVerticalSeamInPlace(energyMap, seam, threads);
+
+	for (int i = 0; i < img.rows; i++) {
+		int lo, hi;
+		seamSpread(seam, i, lo, hi);
+		computeEnergyRegion(img, energyMap, Rect(lo - 1, i, hi - lo + 2, 1));
+	}
+}
+
+// A batch of seams changes a pixel's neighbourhood only if one of them does on its own, so the bands are
+// those of single seams, each at the column where it ends up once the seams left of it are gone
+void updateEnergyAfterVerticalSeams(const Mat& img, Mat& energyMap, const vector<vector<int>>& seams, int threads) {
+	CV_Assert(energyMap.rows == img.rows && energyMap.cols == img.cols + static_cast<int>(seams.size()));
+	removeVerticalSeamsInPlace(energyMap, seams, threads);
+
+	vector<int> shifted(img.rows);
+	for (size_t m = 0; m < seams.size(); m++) {
+		for (int i = 0; i < img.rows; i++)
+			shifted[i] = seams[m][i] - static_cast<int>(m);
+		for (int i = 0; i < img.rows; i++) {
+			int lo, hi;
+			seamSpread(shifted, i, lo, hi);
+			computeEnergyRegion(img, energyMap, Rect(lo - 1, i, hi - lo + 2, 1));
+		}
+	}
+}
+
+// Same as the vertical case with rows and columns swapped
+void updateEnergyAfterHorizontalSeam(const Mat& img, Mat& energyMap, const vector<int>& seam, int threads) {
+	CV_Assert(energyMap.cols == img.cols && energyMap.rows == img.rows + 1);
+	removeHorizontalSeamInPlace(energyMap, seam, threads);
+
+	for (int j = 0; j < img.cols; j++) {
+		int lo, hi;
+		seamSpread(seam, j, lo, hi);
+		computeEnergyRegion(img, energyMap, Rect(j, lo - 1, 1, hi - lo + 2));
+	}
+}
+
+int countEnergyMismatches(const Mat& img, const Mat& energyMap) {
+	Mat reference;
+	computeEnergyMap(img, reference);
+	return countNonZero(reference != energyMap);
+}
+
+Mat calculateEnergyMapOpenCV(const Mat& img) {
+	Mat gray, grad_x, grad_y, abs_grad_x, abs_grad_y, energyMap;
+
+	// Convert to grayscale
+	cvtColor(img, gray, COLOR_BGR2GRAY);
+
+	// Compute gradients along the x and y directions
+	Sobel(gray, grad_x, CV_16S, 1, 0, 3);
+	Sobel(gray, grad_y, CV_16S, 0, 1, 3);
+
+	// Convert gradients to absolute values
+	convertScaleAbs(grad_x, abs_grad_x);
+	convertScaleAbs(grad_y, abs_grad_y);
+
+	// Combine the gradients to get the energy map
+	addWeighted(abs_grad_x, 0.5, abs_grad_y, 0.5, 0, energyMap);
+
+	return energyMap;
+}
+
+} // namespace seam
@@ -0,0 +1,41 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace seam {
+
+// Fused Sobel energy. For 8-bit BGR/BGRA images it produces exactly what the
+// cvtColor -> Sobel -> convertScaleAbs -> addWeighted chain produces, but reads every pixel once
+// and only keeps three rows of luma alive instead of six full-size intermediate Mats.
+// Gray, 16-bit and float images are read natively: gray is its own luma, and gradients are scaled
+// to the 8-bit range (16-bit v * 257 and float v / 255 count as the 8-bit value v).
+void computeEnergyMap(const cv::Mat& img, cv::Mat& energyMap);
+
+// Whether computeEnergyMap handles this Mat type: 8U, 16U or 32F with 1, 3 or 4 channels
+bool fusedEnergySupported(int type);
+
+// Recompute energyMap inside region only. Pixels around the region are read from img as needed,
+// so the result is the same as a full computeEnergyMap restricted to region.
+void computeEnergyRegion(const cv::Mat& img, cv::Mat& energyMap, const cv::Rect& region);
+
+// Keep energyMap in step with an image that just lost a seam: drop the seam from the map and
+// recompute only the pixels whose 3x3 Sobel neighbourhood changed, a band of a few pixels along
+// the seam. img is the image after removal, energyMap the map of the image before it; the seam is
+// removed in place, leaving energyMap a ROI of its old buffer, on up to threads threads like the
+// removals in SeamCarving.h.
+void updateEnergyAfterVerticalSeam(const cv::Mat& img, cv::Mat& energyMap, const std::vector<int>& seam, int threads = 0);
+// The same for a batch of vertical seams removed together (see removeVerticalSeamsInPlace)
+void updateEnergyAfterVerticalSeams(const cv::Mat& img, cv::Mat& energyMap, const std::vector<std::vector<int>>& seams, int threads = 0);
+void updateEnergyAfterHorizontalSeam(const cv::Mat& img, cv::Mat& energyMap, const std::vector<int>& seam, int threads = 0);
+
+// 8-bit luma of img on the scale of the energy map (the same weights and depth scaling), which is what
+// the forward-energy DP measures its intensity differences on
+void computeLumaMap(const cv::Mat& img, cv::Mat& luma);
+
+// Verification for the incremental path: number of pixels where energyMap differs from a full recompute
+int countEnergyMismatches(const cv::Mat& img, const cv::Mat& energyMap);
+
+// The original OpenCV chain, kept as the reference the fused kernel is checked against
+cv::Mat calculateEnergyMapOpenCV(const cv::Mat& img);
+
+} // namespace seam
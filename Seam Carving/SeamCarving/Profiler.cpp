@@ -0,0 +1,63 @@
+#include "Profiler.h"
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+namespace seam {
+
+static thread_local Profile* currentProfile = nullptr;
+
+const char* phaseName(Phase phase) {
+	static const char* names[] = { "Energy", "EnergyUpdate", "DPFill", "Backtrack", "Greedy", "Removal", "Visualization", "Verification", "Transpose", "Pyramid", "BandBound" };
+	static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(Phase::Count), "phase names out of date");
+	return names[static_cast<int>(phase)];
+}
+
+const char* counterName(Counter counter) {
+	static const char* names[] = { "VerticalSeams", "HorizontalSeams", "DPCells", "IncrementalDPFills", "BandedSeams", "BandFallbacks", "PyramidSeams" };
+	static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(Counter::Count), "counter names out of date");
+	return names[static_cast<int>(counter)];
+}
+
+void Profile::merge(const Profile& other) {
+	for (int p = 0; p < static_cast<int>(Phase::Count); p++) {
+		phases[p].calls += other.phases[p].calls;
+		phases[p].ticks += other.phases[p].ticks;
+	}
+	for (int c = 0; c < static_cast<int>(Counter::Count); c++)
+		counters[c] += other.counters[c];
+}
+
+double Profile::milliseconds(Phase p) const {
+	return phase(p).ticks * 1e3 / getTickFrequency();
+}
+
+string Profile::toJSON() const {
+	ostringstream json;
+	json << "{\"enabled\":" << (SEAM_ENABLE_PROFILING ? "true" : "false") << ",\"phases\":{";
+	for (int p = 0; p < static_cast<int>(Phase::Count); p++) {
+		Phase current = static_cast<Phase>(p);
+		json << (p ? "," : "") << "\"" << phaseName(current) << "\":{\"calls\":" << phase(current).calls
+			<< ",\"ms\":" << milliseconds(current) << "}";
+	}
+	json << "},\"counters\":{";
+	for (int c = 0; c < static_cast<int>(Counter::Count); c++)
+		json << (c ? "," : "") << "\"" << counterName(static_cast<Counter>(c)) << "\":" << counters[c];
+	json << "}}";
+	return json.str();
+}
+
+Profile* activeProfile() {
+	return currentProfile;
+}
+
+ProfileScope::ProfileScope(Profile& profile) : previous(currentProfile) {
+	currentProfile = &profile;
+}
+
+ProfileScope::~ProfileScope() {
+	currentProfile = previous;
+}
+
+} // namespace seam
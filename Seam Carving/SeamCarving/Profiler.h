@@ -0,0 +1,132 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+
+// Per-phase timers and counters for the carving loop. SEAM_ENABLE_PROFILING=1 compiles them in; by
+// default they are on in debug builds and off when NDEBUG is defined, in which case the
+// SEAM_PROFILE_* macros expand to nothing and Profile only ever holds zeros.
+#ifndef SEAM_ENABLE_PROFILING
+#ifdef NDEBUG
+#define SEAM_ENABLE_PROFILING 0
+#else
+#define SEAM_ENABLE_PROFILING 1
+#endif
+#endif
+
+namespace seam {
+
+enum class Phase {
+	Energy,			// full energy map
+	EnergyUpdate,	// carving the energy map and patching it along the seam
+	DPFill,			// cost table (full or incremental)
+	Backtrack,		// seam trace through the parent table
+	Greedy,			// greedy seam search
+	Removal,		// removing the seam from the image
+	Visualization,	// the per-seam callback (drawing, display)
+	Verification,	// Options::verifyEnergy full recomputes
+	Transpose,		// switching the working copy between orientations
+	Pyramid,		// downscaled maps for the coarse-to-fine search
+	BandBound,		// lower bound that certifies a band seam
+	Count
+};
+
+enum class Counter {
+	VerticalSeams,
+	HorizontalSeams,
+	DPCells,			// cost table cells computed
+	IncrementalDPFills,	// vertical tables updated in the cone only
+	BandedSeams,		// vertical seams found by the banded search
+	BandFallbacks,		// banded searches rejected in favour of the full DP
+	PyramidSeams,		// vertical seams found coarse-to-fine
+	Count
+};
+
+const char* phaseName(Phase phase);
+const char* counterName(Counter counter);
+
+// Totals for one job (or several merged). Profiles are plain data: collecting is done through the
+// profile made active on the current thread with ProfileScope.
+class Profile {
+public:
+	struct PhaseTotal {
+		uint64_t calls = 0;
+		int64_t ticks = 0;
+	};
+
+	void reset() { *this = Profile(); }
+	void merge(const Profile& other);
+
+	void addTime(Phase phase, int64_t ticks) {
+		PhaseTotal& total = phases[static_cast<int>(phase)];
+		total.calls++;
+		total.ticks += ticks;
+	}
+	void addCount(Counter counter, uint64_t amount) { counters[static_cast<int>(counter)] += amount; }
+
+	const PhaseTotal& phase(Phase p) const { return phases[static_cast<int>(p)]; }
+	double milliseconds(Phase p) const;
+	uint64_t count(Counter counter) const { return counters[static_cast<int>(counter)]; }
+
+	// {"enabled":..,"phases":{"Energy":{"calls":..,"ms":..},..},"counters":{..}}
+	std::string toJSON() const;
+
+private:
+	PhaseTotal phases[static_cast<int>(Phase::Count)];
+	uint64_t counters[static_cast<int>(Counter::Count)] = {};
+};
+
+// Profile that the SEAM_PROFILE_* macros on this thread record into, null when none
+Profile* activeProfile();
+
+// Makes profile the active one on this thread for the lifetime of the scope
+class ProfileScope {
+public:
+	explicit ProfileScope(Profile& profile);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	Profile* previous;
+};
+
+// Adds the time until the end of the scope to a phase of the active profile
+class PhaseTimer {
+public:
+	explicit PhaseTimer(Phase which) : phase(which), profile(activeProfile()) {
+		if (profile)
+			start = cv::getTickCount();
+	}
+	~PhaseTimer() {
+		if (profile)
+			profile->addTime(phase, cv::getTickCount() - start);
+	}
+
+	PhaseTimer(const PhaseTimer&) = delete;
+	PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+	Phase phase;
+	Profile* profile;
+	int64_t start = 0;
+};
+
+inline void profileCount(Counter counter, uint64_t amount) {
+	if (Profile* profile = activeProfile())
+		profile->addCount(counter, amount);
+}
+
+} // namespace seam
+
+#define SEAM_PROFILE_CONCAT_(a, b) a##b
+#define SEAM_PROFILE_CONCAT(a, b) SEAM_PROFILE_CONCAT_(a, b)
+
+#if SEAM_ENABLE_PROFILING
+#define SEAM_PROFILE_PHASE(phase) ::seam::PhaseTimer SEAM_PROFILE_CONCAT(seamPhaseTimer, __LINE__)(::seam::Phase::phase)
+#define SEAM_PROFILE_COUNT(counter, amount) ::seam::profileCount(::seam::Counter::counter, (amount))
+#else
+#define SEAM_PROFILE_PHASE(phase) ((void)0)
+#define SEAM_PROFILE_COUNT(counter, amount) ((void)0)
+#endif
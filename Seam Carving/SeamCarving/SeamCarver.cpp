@@ -0,0 +1,386 @@
+#include "SeamCarver.h"
+#include "SeamCarving.h"
+#include "Energy.h"
+#include "Profiler.h"
+
+using namespace cv;
+using namespace std;
+
+namespace seam {
+
+void SeamCarver::reserve(Size maxSize) {
+	finder.reserve(maxSize.height, maxSize.width);
+	seamVertical.reserve(maxSize.height);
+	seamHorizontal.reserve(maxSize.width);
+}
+
+// ROI of buffer for a rows x cols image, growing buffer only when it is too small or of another type
+static Mat workRegion(Mat& buffer, int rows, int cols, int type) {
+	if (buffer.type() != type || buffer.rows < rows || buffer.cols < cols)
+		buffer.create(max(buffer.rows, rows), max(buffer.cols, cols), type);
+	return buffer(Rect(0, 0, cols, rows));
+}
+
+// Flip img and the energy (or luma) map between the normal and the transposed orientation. The Sobel
+// energy of a transposed image is the transposed energy, so the map is carried over instead of recomputed.
+void SeamCarver::setTransposed(Mat& img, bool value, const Options& options) {
+	if (transposed == value)
+		return;
+	SEAM_PROFILE_PHASE(Transpose);
+
+	Mat flipped;
+	if (options.inPlaceRemoval)
+		flipped = workRegion(value ? transposedBuffer : workBuffer, img.cols, img.rows, img.type());
+	transpose(img, flipped);
+	img = flipped;
+
+	for (Mat* map : { &energyMap, &lumaMap }) {
+		if (map->empty())
+			continue;
+		Mat mapFlipped;
+		transpose(*map, mapFlipped);
+		*map = mapFlipped;
+	}
+
+	for (Mat& plane : carried) {
+		Mat planeFlipped;
+		transpose(plane, planeFlipped);
+		plane = planeFlipped;
+	}
+
+	// The kept DP table and the previous seam belong to the other orientation
+	finder.invalidateTable();
+	previousSeamUsable = false;
+	transposed = value;
+}
+
+// Remove the seam from img and every carried plane. In place that is a single pass over the rows
+// for all of them; the allocating variant handles one plane after the other.
+void SeamCarver::removeSeamFromPlanes(Mat& img, const vector<int>& seam, bool vertical, const Options& options) {
+	int threads = options.threads;
+	if (!options.inPlaceRemoval) {
+		img = vertical ? removeVerticalSeam(img, seam, threads) : removeHorizontalSeam(img, seam, threads);
+		for (Mat& plane : carried)
+			plane = vertical ? removeVerticalSeam(plane, seam, threads) : removeHorizontalSeam(plane, seam, threads);
+		return;
+	}
+	if (carried.empty()) {
+		if (vertical)
+			removeVerticalSeamInPlace(img, seam, threads);
+		else
+			removeHorizontalSeamInPlace(img, seam, threads);
+		return;
+	}
+
+	planeHeaders.assign(1, img);
+	planeHeaders.insert(planeHeaders.end(), carried.begin(), carried.end());
+	if (vertical)
+		removeVerticalSeamInPlace(planeHeaders, seam, threads);
+	else
+		removeHorizontalSeamInPlace(planeHeaders, seam, threads);
+	img = planeHeaders[0];
+	copy(planeHeaders.begin() + 1, planeHeaders.end(), carried.begin());
+}
+
+// One vertical seam out of img. On the transposed image that is a horizontal seam of the real
+// image, which is how the callback and the profile see it.
+template <bool Visualize>
+void SeamCarver::carveVerticalSeam(Mat& img, const Options& options) {
+	bool greedy = options.algorithm == SeamAlgorithm::Greedy;
+	bool forward = !lumaMap.empty();
+
+	// Find the vertical seam, near the previous one of this run first if the band is on
+	const Mat& map = forward ? lumaMap : energyMap;
+	bool banded = false;
+	if (!greedy && options.bandRadius > 0 && previousSeamUsable) {
+		if (options.bandExact)
+			banded = findVerticalSeamBanded(map, finder, seamVertical, options.bandRadius, forward);
+		else {
+			int64_t maxCost = static_cast<int64_t>(previousSeamCost * (1 + options.bandCostSlack));
+			banded = findVerticalSeamBandedApprox(map, finder, seamVertical, options.bandRadius, maxCost, forward);
+		}
+		if (banded) {
+			seamVertical = finder.seam();
+			SEAM_PROFILE_COUNT(BandedSeams, 1);
+		}
+		else
+			SEAM_PROFILE_COUNT(BandFallbacks, 1);
+	}
+
+	if (!banded) {
+		if (greedy)
+			seamVertical = findVerticalSeamGreedy(energyMap);
+		else if (options.pyramidLevels > 0)
+			seamVertical = findVerticalSeamPyramid(map, finder, options.pyramidLevels, options.pyramidCorridor, forward);
+		else if (forward)
+			seamVertical = findVerticalSeamForward(lumaMap, finder);
+		else
+			seamVertical = findVerticalSeam(energyMap, finder);
+	}
+
+	previousSeamCost = verticalSeamCost(map, seamVertical, forward);
+	removedCost += previousSeamCost;
+
+	if constexpr (Visualize) {
+		SEAM_PROFILE_PHASE(Visualization);
+		if (transposed) {
+			Mat view;
+			transpose(img, view);
+			seamCallback(view, seamVertical, SeamDirection::Horizontal);
+		}
+		else
+			seamCallback(img, seamVertical, SeamDirection::Vertical);
+	}
+
+	// Remove the vertical seam and patch the energy along it (the luma map only loses the seam)
+	{
+		SEAM_PROFILE_PHASE(Removal);
+		removeSeamFromPlanes(img, seamVertical, true, options);
+	}
+	{
+		SEAM_PROFILE_PHASE(EnergyUpdate);
+		if (forward)
+			removeVerticalSeamInPlace(lumaMap, seamVertical, options.threads);
+		else
+			updateEnergyAfterVerticalSeam(img, energyMap, seamVertical, options.threads);
+	}
+	if (!greedy)
+		finder.verticalSeamRemoved(seamVertical);
+	previousSeamUsable = !greedy && options.bandRadius > 0;
+	if (options.verifyEnergy && !forward) {
+		SEAM_PROFILE_PHASE(Verification);
+		mismatches += countEnergyMismatches(img, energyMap);
+	}
+	if (transposed)
+		SEAM_PROFILE_COUNT(HorizontalSeams, 1);
+	else
+		SEAM_PROFILE_COUNT(VerticalSeams, 1);
+}
+
+// Up to count vertical seams out of img from a single DP table, removed from the image, the carried
+// planes and the energy (or luma) map in one pass each. Falls back to one seam at a time for the greedy
+// finder and for batches of one. Returns the number of seams removed.
+template <bool Visualize>
+int SeamCarver::carveVerticalSeams(Mat& img, const Options& options, int count) {
+	count = min(count, max(options.seamsPerPass, 1));
+	if (count == 1 || options.algorithm == SeamAlgorithm::Greedy) {
+		carveVerticalSeam<Visualize>(img, options);
+		return 1;
+	}
+
+	bool forward = !lumaMap.empty();
+	const Mat& map = forward ? lumaMap : energyMap;
+	int found = findVerticalSeams(map, finder, count, seamBatch, forward);
+	for (const vector<int>& seam : seamBatch)
+		removedCost += verticalSeamCost(map, seam, forward);
+
+	if constexpr (Visualize) {
+		SEAM_PROFILE_PHASE(Visualization);
+		Mat view = img;
+		if (transposed)
+			transpose(img, view);
+		for (int m = 0; m < found; m++)
+			seamCallback(view, seamBatch[m], transposed ? SeamDirection::Horizontal : SeamDirection::Vertical);
+	}
+
+	// The batch removal is in place only; the allocating mode gets one new copy per batch
+	{
+		SEAM_PROFILE_PHASE(Removal);
+		if (!options.inPlaceRemoval) {
+			img = img.clone();
+			for (Mat& plane : carried)
+				plane = plane.clone();
+		}
+		planeHeaders.assign(1, img);
+		planeHeaders.insert(planeHeaders.end(), carried.begin(), carried.end());
+		removeVerticalSeamsInPlace(planeHeaders, seamBatch, options.threads);
+		img = planeHeaders[0];
+		copy(planeHeaders.begin() + 1, planeHeaders.end(), carried.begin());
+	}
+	{
+		SEAM_PROFILE_PHASE(EnergyUpdate);
+		if (forward)
+			removeVerticalSeamsInPlace(lumaMap, seamBatch, options.threads);
+		else
+			updateEnergyAfterVerticalSeams(img, energyMap, seamBatch, options.threads);
+	}
+
+	// The incremental DP and the band follow single seams only
+	finder.invalidateTable();
+	previousSeamUsable = false;
+	if (options.verifyEnergy && !forward) {
+		SEAM_PROFILE_PHASE(Verification);
+		mismatches += countEnergyMismatches(img, energyMap);
+	}
+	if (transposed)
+		SEAM_PROFILE_COUNT(HorizontalSeams, found);
+	else
+		SEAM_PROFILE_COUNT(VerticalSeams, found);
+	return found;
+}
+
+// One horizontal seam out of img in the normal orientation (column-wise DP and removal)
+template <bool Visualize>
+void SeamCarver::carveHorizontalSeam(Mat& img, const Options& options) {
+	bool forward = !lumaMap.empty();
+
+	// Find the horizontal seam
+	if (options.algorithm == SeamAlgorithm::Greedy)
+		seamHorizontal = findHorizontalSeamGreedy(energyMap);
+	else if (forward)
+		seamHorizontal = findHorizontalSeamForward(lumaMap, finder);
+	else
+		seamHorizontal = findHorizontalSeam(energyMap, finder);
+
+	removedCost += horizontalSeamCost(forward ? lumaMap : energyMap, seamHorizontal, forward);
+
+	if constexpr (Visualize) {
+		SEAM_PROFILE_PHASE(Visualization);
+		seamCallback(img, seamHorizontal, SeamDirection::Horizontal);
+	}
+
+	// Remove the horizontal seam and patch the energy along it
+	{
+		SEAM_PROFILE_PHASE(Removal);
+		removeSeamFromPlanes(img, seamHorizontal, false, options);
+	}
+	{
+		SEAM_PROFILE_PHASE(EnergyUpdate);
+		if (forward)
+			removeHorizontalSeamInPlace(lumaMap, seamHorizontal, options.threads);
+		else
+			updateEnergyAfterHorizontalSeam(img, energyMap, seamHorizontal, options.threads);
+	}
+	previousSeamUsable = false;
+	if (options.verifyEnergy && !forward) {
+		SEAM_PROFILE_PHASE(Verification);
+		mismatches += countEnergyMismatches(img, energyMap);
+	}
+	SEAM_PROFILE_COUNT(HorizontalSeams, 1);
+}
+
+// The seam loop: carve img down to target, in the order options ask for
+template <bool Visualize>
+void SeamCarver::carve(Mat& img, Size target, const Options& options) {
+	// Current size in the orientation of the input
+	auto width = [&] { return transposed ? img.rows : img.cols; };
+	auto height = [&] { return transposed ? img.cols : img.rows; };
+
+	// A horizontal seam either runs through the column-wise finder and removal, or, on the transposed
+	// image, through the same contiguous row kernels as a vertical one. Runs (remaining > 1) may take
+	// several seams from one table.
+	auto vertical = [&](int remaining) {
+		setTransposed(img, false, options);
+		carveVerticalSeams<Visualize>(img, options, remaining);
+	};
+	auto horizontal = [&](bool viaTranspose, int remaining) {
+		setTransposed(img, viaTranspose, options);
+		if (viaTranspose)
+			carveVerticalSeams<Visualize>(img, options, remaining);
+		else
+			carveHorizontalSeam<Visualize>(img, options);
+	};
+
+	// A transpose costs about as much as removing a seam, so the interleaved phase never switches
+	// orientation per seam: only runs of horizontal seams go through the transposed image
+	bool transposeRuns = options.transposeHorizontal;
+	switch (options.order) {
+	case CarveOrder::Interleaved:
+		while (width() > target.width && height() > target.height) {
+			vertical(1);
+			horizontal(false, 1);
+		}
+		break;
+	case CarveOrder::HorizontalFirst:
+		while (height() > target.height)
+			horizontal(transposeRuns, height() - target.height);
+		break;
+	case CarveOrder::VerticalFirst:
+		break;
+	}
+	while (width() > target.width)
+		vertical(width() - target.width);
+	while (height() > target.height)
+		horizontal(transposeRuns, height() - target.height);
+	setTransposed(img, false, options);
+}
+
+Mat SeamCarver::retarget(const Mat& input, Size target, const Options& options) {
+	vector<Mat> noPlanes;
+	return retarget(input, target, options, noPlanes);
+}
+
+Mat SeamCarver::retarget(const Mat& input, Size target, const Options& options, vector<Mat>& planes) {
+	CV_Assert(!input.empty());
+	CV_Assert(target.width > 0 && target.height > 0);
+	CV_Assert(target.width <= input.cols && target.height <= input.rows);
+	for (const Mat& plane : planes)
+		CV_Assert(plane.size() == input.size());
+
+	bool greedy = options.algorithm == SeamAlgorithm::Greedy;
+	mismatches = 0;
+	removedCost = 0;
+	transposed = false;
+	previousSeamUsable = false;
+
+	// Everything below, including the seam callback, records into this job's profile
+	jobProfile.reset();
+	ProfileScope profileScope(jobProfile);
+
+	// DP work buffers are sized once for the input image and reused for every seam; the transposed
+	// image has the same number of cells
+	finder.setParentEncoding(options.parentEncoding);
+	finder.setIncremental(!greedy && options.incrementalDP, options.maxConeFraction);
+	finder.setParallelFill(options.parallelDPRows);
+	finder.setThreads(options.threads);
+	finder.setTiledFill(options.dpTileCols, options.dpTileRows);
+	reserve(input.size());
+
+	// In-place carving works on a private copy, in a buffer that is only reallocated when it is too
+	// small for the image (or of another type)
+	Mat img = input;
+	if (options.inPlaceRemoval) {
+		img = workRegion(workBuffer, input.rows, input.cols, input.type());
+		input.copyTo(img);
+	}
+
+	// Auxiliary planes follow the image through every removal and transpose
+	if (planeBuffers.size() < planes.size())
+		planeBuffers.resize(planes.size());
+	carried.resize(planes.size());
+	for (size_t k = 0; k < planes.size(); k++) {
+		carried[k] = planes[k];
+		if (options.inPlaceRemoval) {
+			carried[k] = workRegion(planeBuffers[k], input.rows, input.cols, planes[k].type());
+			planes[k].copyTo(carried[k]);
+		}
+	}
+
+	// The energy map (or, for forward energy, the luma map) is computed once and then carved together
+	// with the image
+	{
+		SEAM_PROFILE_PHASE(Energy);
+		energyMap.release();
+		lumaMap.release();
+		if (!greedy && options.energy == SeamEnergy::Forward)
+			computeLumaMap(img, lumaMap);
+		else
+			energyMap = calculateEnergyMap(img);
+	}
+
+	// Headless jobs run the instantiation without any callback code in the seam loop
+	if (seamCallback)
+		carve<true>(img, target, options);
+	else
+		carve<false>(img, target, options);
+
+	// The only full copy of the job: compact the working ROIs (and never hand back the caller's own
+	// buffers when nothing was removed)
+	for (size_t k = 0; k < planes.size(); k++)
+		planes[k] = options.inPlaceRemoval || carried[k].data == planes[k].data ? carried[k].clone() : carried[k];
+	carried.clear();
+	planeHeaders.clear();
+	return options.inPlaceRemoval || img.data == input.data ? img.clone() : img;
+}
+
+} // namespace seam
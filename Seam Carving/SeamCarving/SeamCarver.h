@@ -0,0 +1,165 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include "Profiler.h"
+#include "SeamFinderContext.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace seam {
+
+enum class SeamAlgorithm {
+	DynamicProgramming,
+	Greedy
+};
+
+// What a seam costs. Backward: the Sobel energy of the pixels it removes. Forward: the intensity
+// differences between the pixels that become neighbours once it is gone, which avoids the jagged
+// edges backward energy leaves behind (DP only; the greedy finder always uses backward energy).
+enum class SeamEnergy {
+	Backward,
+	Forward
+};
+
+enum class SeamDirection {
+	Vertical,
+	Horizontal
+};
+
+// In which order seams come out when both dimensions shrink
+enum class CarveOrder {
+	Interleaved,	// one vertical, one horizontal, ... (the original behaviour)
+	VerticalFirst,
+	HorizontalFirst
+};
+
+struct Options {
+	SeamAlgorithm algorithm = SeamAlgorithm::DynamicProgramming;
+	SeamEnergy energy = SeamEnergy::Backward;
+
+	// DP parent table layout, see ParentEncoding
+	ParentEncoding parentEncoding = ParentEncoding::Offset8;
+
+	// Recompute only the DP cone below each removed vertical seam (Offset8 only)
+	bool incrementalDP = true;
+	double maxConeFraction = 0.5;
+
+	// Remove seams inside one working copy of the image (memmove per row, ROI header) and make a compact
+	// copy only at the end, instead of allocating and copying a new image for every seam
+	bool inPlaceRemoval = true;
+
+	CarveOrder order = CarveOrder::Interleaved;
+
+	// Carve runs of horizontal seams as vertical seams of a transposed working copy, so they use the
+	// row-contiguous DP kernels and removal. The seams are the same either way.
+	bool transposeHorizontal = true;
+
+	// Seams taken from each DP table in runs of vertical seams (and of horizontal seams carved on the
+	// transposed image), removed together with a single energy update. 1 carves one seam per table,
+	// more trade seam quality for speed (see findVerticalSeams); the greedy finder always takes one.
+	int seamsPerPass = 1;
+
+	// Banded search: in runs of single vertical seams, run the DP only within bandRadius columns of the
+	// previous seam and fall back to the full DP unless the band seam is provably the cheapest
+	// (findVerticalSeamBanded). With bandExact off, the band seam is only rejected when it runs along a
+	// band edge or costs more than (1 + bandCostSlack) times the previous seam, which is faster but
+	// approximate. 0 turns it off. Offset8 parents only.
+	int bandRadius = 0;
+	bool bandExact = true;
+	double bandCostSlack = 0.25;
+
+	// Coarse-to-fine search for single vertical seams (findVerticalSeamPyramid) through up to
+	// pyramidLevels halvings of the map, refined within pyramidCorridor columns per level. 0 runs the
+	// exact DP. With a band, the pyramid replaces the full DP fallback.
+	int pyramidLevels = 0;
+	int pyramidCorridor = 4;
+
+	// Full DP fills split each block of parallelDPRows rows into column strips on OpenCV's threads
+	// (threads, or cv::setNumThreads); the tables and seams are identical to a serial fill. 0 fills serially.
+	int parallelDPRows = 32;
+
+	// Threads this carver's parallel DP fills and seam removals may use, instead of cv::getNumThreads().
+	// 1 keeps the carver on its calling thread (one carver per worker thread) without touching OpenCV's
+	// global setting; 0 follows it. OpenCV's own functions (colour conversion, transposes) still do.
+	int threads = 0;
+
+	// Single-threaded full DP fills in skewed tiles of dpTileCols columns by dpTileRows rows for cache
+	// reuse on very wide images (identical tables). 0 fills row by row, the default: the cost and parent
+	// tables are written in full either way, and tiling has not consistently beaten the row-by-row fill.
+	// The dp-tiled benchmark shows the time and cache misses per tile shape on a given machine.
+	int dpTileCols = 0;
+	int dpTileRows = 64;
+
+	// Compare the incrementally maintained energy map with a full recompute after every seam
+	bool verifyEnergy = false;
+};
+
+// Content-aware resizing of one image at a time. A SeamCarver owns all work buffers (DP tables,
+// energy map, seams), so reusing one instance for many images of similar size avoids reallocating
+// them. Not thread-safe: use one instance per thread.
+class SeamCarver {
+public:
+	// Called with the current image and the seam about to be removed from it, e.g. to show progress.
+	// Within a batch (Options::seamsPerPass) img is the image before the batch for every seam, and each
+	// seam is in that image's coordinates: it marks exactly the pixels the batch removes.
+	typedef std::function<void(const cv::Mat& img, const std::vector<int>& seam, SeamDirection direction)> SeamCallback;
+
+	SeamCarver() = default;
+	explicit SeamCarver(cv::Size maxSize) { reserve(maxSize); }
+
+	// Preallocate the work buffers for images up to maxSize
+	void reserve(cv::Size maxSize);
+
+	// Remove seams from img until it is target.width x target.height. Vertical and horizontal seams
+	// alternate while both dimensions are too large. The target may not exceed the image size.
+	cv::Mat retarget(const cv::Mat& img, cv::Size target, const Options& options = Options());
+
+	// Same, carrying auxiliary planes (alpha matte, segmentation mask, depth, ...) of the same size
+	// but any type along: every seam found on img is removed from them as well, in the same pass.
+	// On return planes holds the carved planes. Only img drives the energy.
+	cv::Mat retarget(const cv::Mat& img, cv::Size target, const Options& options, std::vector<cv::Mat>& planes);
+
+	void setSeamCallback(SeamCallback callback) { seamCallback = std::move(callback); }
+
+	// Pixels where the incremental energy map disagreed with a full recompute in the last
+	// retarget (only counted with Options::verifyEnergy)
+	int energyMismatches() const { return mismatches; }
+
+	const SeamFinderContext& finderContext() const { return finder; }
+
+	// Total cost of the seams removed by the last retarget, in the energy the DP ran on (Sobel energy
+	// of the removed pixels, or their forward cost), to compare batch sizes against one seam per table
+	int64_t removedEnergy() const { return removedCost; }
+
+	// Per-phase timings and counters of the last retarget (all zero unless SEAM_ENABLE_PROFILING)
+	const Profile& profile() const { return jobProfile; }
+
+private:
+	void setTransposed(cv::Mat& img, bool value, const Options& options);
+	// Visualize compiles the seam callback in; retarget picks the instantiation once per job
+	template <bool Visualize> void carve(cv::Mat& img, cv::Size target, const Options& options);
+	template <bool Visualize> void carveVerticalSeam(cv::Mat& img, const Options& options);
+	template <bool Visualize> int carveVerticalSeams(cv::Mat& img, const Options& options, int count);
+	template <bool Visualize> void carveHorizontalSeam(cv::Mat& img, const Options& options);
+	void removeSeamFromPlanes(cv::Mat& img, const std::vector<int>& seam, bool vertical, const Options& options);
+
+	SeamFinderContext finder;
+	cv::Mat energyMap;
+	cv::Mat lumaMap;	// instead of energyMap with forward energy, carved along with the image
+	cv::Mat workBuffer;	// in-place carving happens in a ROI of this, kept across images
+	cv::Mat transposedBuffer;	// same for the transposed orientation
+	bool transposed = false;	// img and energyMap currently hold the transposed image
+	std::vector<cv::Mat> planeBuffers;	// like workBuffer, for the auxiliary planes
+	std::vector<cv::Mat> carried;	// auxiliary planes being carved
+	std::vector<cv::Mat> planeHeaders;	// image plus carried planes, handed to the multi-plane removal
+	std::vector<int> seamVertical, seamHorizontal;
+	std::vector<std::vector<int>> seamBatch;
+	SeamCallback seamCallback;
+	int mismatches = 0;
+	int64_t removedCost = 0;
+	bool previousSeamUsable = false;	// seamVertical is the last seam of the current run, for the band
+	int64_t previousSeamCost = 0;
+	Profile jobProfile;
+};
+
+} // namespace seam
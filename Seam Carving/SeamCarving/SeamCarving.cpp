@@ -1,231 +1,842 @@
 #include "SeamCarving.h"
+#include "DPKernels.h"
+#include "Energy.h"
+#include "Profiler.h"
+#include <opencv2/imgproc.hpp>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <limits>
+#include <type_traits>
 
 using namespace cv;
 using namespace std;
+
+namespace seam {
+
 // Function to calculate the energy map using the Sobel filter
 Mat calculateEnergyMap(const Mat& img) {
-	Mat gray, grad_x, grad_y, abs_grad_x, abs_grad_y, energyMap;
+	// 8/16-bit and float images with 1, 3 or 4 channels go through the fused single-pass kernel,
+	// anything else through the OpenCV chain
+	if (!fusedEnergySupported(img.type()))
+		return calculateEnergyMapOpenCV(img);
 
-	// Convert to grayscale
-	cvtColor(img, gray, COLOR_BGR2GRAY);
+	Mat energyMap;
+	computeEnergyMap(img, energyMap);
+	return energyMap;
+}
 
-	// Compute gradients along the x and y directions
-	Sobel(gray, grad_x, CV_16S, 1, 0, 3);
-	Sobel(gray, grad_y, CV_16S, 0, 1, 3);
+// Seam orientations for the kernels below. A seam has one position per line: the column in each row
+// for a vertical seam, the row in each column for a horizontal one. Everything orientation specific
+// is resolved at compile time, so the inner loops carry no direction checks.
+struct VerticalSeam {
+	static constexpr const char* lineName = "row";
+
+	static int lines(const Mat& m) { return m.rows; }
+	static int span(const Mat& m) { return m.cols; }
+	template <typename T>
+	static T& at(Mat& m, int line, int pos) { return m.ptr<T>(line)[pos]; }
+	template <typename T>
+	static const T& at(const Mat& m, int line, int pos) { return m.ptr<T>(line)[pos]; }
+
+	// The energy map already is line-major
+	static Mat energyLines(const Mat& energyMap, SeamFinderContext&) { return energyMap; }
+
+	static Mat narrowed(const Mat& img) { return img.colRange(0, img.cols - 1); }
+};
+
+struct HorizontalSeam {
+	static constexpr const char* lineName = "column";
+
+	static int lines(const Mat& m) { return m.cols; }
+	static int span(const Mat& m) { return m.rows; }
+	template <typename T>
+	static T& at(Mat& m, int line, int pos) { return m.ptr<T>(pos)[line]; }
+	template <typename T>
+	static const T& at(const Mat& m, int line, int pos) { return m.ptr<T>(pos)[line]; }
+
+	// One blocked transpose into the context's scratch, after which the DP runs over contiguous lines
+	// exactly like the vertical one instead of striding down the columns of the map
+	static Mat energyLines(const Mat& energyMap, SeamFinderContext& ctx) {
+		Mat lines(energyMap.cols, energyMap.rows, CV_8UC1, ctx.energyLines(energyMap.total()));
+		transpose(energyMap, lines);
+		return lines;
+	}
 
-	// Convert gradients to absolute values
-	convertScaleAbs(grad_x, abs_grad_x);
-	convertScaleAbs(grad_y, abs_grad_y);
+	static Mat narrowed(const Mat& img) { return img.rowRange(0, img.rows - 1); }
+};
 
-	// Combine the gradients to get the energy map
-	addWeighted(abs_grad_x, 0.5, abs_grad_y, 0.5, 0, energyMap);
+// DP over the lines of the energy map. The cost and parent tables are line-major (lines x span),
+// which is row-major for vertical seams and column-major for horizontal ones. With forward energy the
+// map is the 8-bit luma of the image and the step costs come from the forward kernels.
+template <class Direction>
+static void fillSeamTable(const Mat& energyMap, SeamFinderContext& ctx, bool forward) {
+	int rows = Direction::lines(energyMap), cols = Direction::span(energyMap);
+	ctx.reserve(energyMap.rows, energyMap.cols);
 
-	return energyMap;
-}
+	// Only a vertical table can be updated incrementally, a horizontal search overwrites it
+	if constexpr (is_same_v<Direction, HorizontalSeam>)
+		ctx.invalidateTable();
 
-// Function to find the minimum vertical seam
-vector<int> findVerticalSeam(const Mat& energyMap) {
-	int rows = energyMap.rows, cols = energyMap.cols;
-	vector<vector<int>> weighted_map(rows, vector<int>(cols, 0));
-	vector<vector<int>> path_table(rows, vector<int>(cols, 0));
-
-	// Initialize the weighted_map table with the first row of energy values
-	for (int j = 0; j < cols; j++)
-		weighted_map[0][j] = energyMap.at<uchar>(0, j);
+	// Parents are -1/0/+1 offsets along the span
+	int* weighted_map = ctx.costs();
+	bool packed = ctx.parentEncoding() == ParentEncoding::Packed2;
+	size_t packedStride = packedParentStride(cols);
 
-	// Fill the weighted_map table
-	for (int i = 1; i < rows; i++)
+	// After a removal only the cone below the removed seam needs recomputing, if it is small enough
+	size_t cells = static_cast<size_t>(rows) * cols;
 	{
-		for (int j = 0; j < cols; j++)
-		{
-			weighted_map[i][j] = weighted_map[i - 1][j];
-			path_table[i][j] = j;
-
-			if (j > 0 && weighted_map[i - 1][j - 1] < weighted_map[i][j])
-			{
-				weighted_map[i][j] = weighted_map[i - 1][j - 1];
-				path_table[i][j] = j - 1;
+		SEAM_PROFILE_PHASE(DPFill);
+		Mat energy = Direction::energyLines(energyMap, ctx);
+		auto fillSerial = forward ? fillForwardCostTable : fillCostTable;
+		auto fillParallel = forward ? fillForwardCostTableParallel : fillCostTableParallel;
+		auto fillTiled = forward ? fillForwardCostTableTiled : fillCostTableTiled;
+		auto fillTable = [&](const uchar* map, size_t step, int rows, int cols, int* cost, schar* parent) {
+			int threads = ctx.threads() > 0 ? ctx.threads() : getNumThreads();
+			if (ctx.parallelFillRows() > 0 && threads > 1)
+				fillParallel(map, step, rows, cols, cost, parent, threads, ctx.parallelFillRows());
+			else if (ctx.tiledFillCols() > 0)
+				fillTiled(map, step, rows, cols, cost, parent, ctx.tiledFillCols(), ctx.tiledFillRows());
+			else
+				fillSerial(map, step, rows, cols, cost, parent);
+		};
+		if (ctx.canUpdateTable(rows, cols, forward)) {
+			const int* removed = ctx.removedSeam().data();
+			size_t cone = costTableConeCells(rows, cols, removed);
+			if (cone <= ctx.maxConeFraction() * cells) {
+				auto updateTable = forward ? updateForwardCostTable : updateCostTable;
+				updateTable(energy.ptr<uchar>(0), energy.step, rows, cols, removed, weighted_map, ctx.parents());
+				cells = cone;
+				SEAM_PROFILE_COUNT(IncrementalDPFills, 1);
 			}
-			if (j < cols - 1 && weighted_map[i - 1][j + 1] < weighted_map[i][j])
+			else
+				fillTable(energy.ptr<uchar>(0), energy.step, rows, cols, weighted_map, ctx.parents());
+		}
+		else if (!packed) {
+			fillTable(energy.ptr<uchar>(0), energy.step, rows, cols, weighted_map, ctx.parents());
+		}
+		else {
+			// Initialize the weighted_map table with the first line of energy values
+			const uchar* first = energy.ptr<uchar>(0);
+			if (forward)
+				forwardFirstRow(first, weighted_map, cols, 0, cols);
+			else
+				for (int j = 0; j < cols; j++)
+					weighted_map[j] = first[j];
+
+			// Fill the weighted_map table one line at a time, packing each parent line as it is produced
+			DPRowKernel fillRow = getDPRowKernel();
+			ForwardRowKernel fillForwardRow = getForwardRowKernel();
+			for (int i = 1; i < rows; i++)
 			{
-				weighted_map[i][j] = weighted_map[i - 1][j + 1];
-				path_table[i][j] = j + 1;
+				const int* prev = weighted_map + static_cast<size_t>(i - 1) * cols;
+				int* cur = weighted_map + static_cast<size_t>(i) * cols;
+				if (forward)
+					fillForwardRow(prev, energy.ptr<uchar>(i - 1), energy.ptr<uchar>(i), cur, ctx.parents(), cols, 0, cols);
+				else
+					fillRow(prev, energy.ptr<uchar>(i), cur, ctx.parents(), cols, 0, cols);
+				packParentRow(ctx.parents(), ctx.packedParents() + i * packedStride, cols);
 			}
-			weighted_map[i][j] += energyMap.at<uchar>(i, j);
 		}
+		ctx.tableFilled(rows, cols, cells, forward);
+		SEAM_PROFILE_COUNT(DPCells, cells);
 	}
+}
+
+// Parent offset of cell j in line i of the last table
+static inline int parentAt(SeamFinderContext& ctx, int cols, int i, int j) {
+	if (ctx.parentEncoding() == ParentEncoding::Packed2)
+		return unpackParent(ctx.packedParents() + i * packedParentStride(cols), j);
+	return ctx.parents()[static_cast<size_t>(i) * cols + j];
+}
+
+template <class Direction>
+static const vector<int>& findSeam(const Mat& energyMap, SeamFinderContext& ctx, bool forward) {
+	fillSeamTable<Direction>(energyMap, ctx, forward);
+
+	int rows = Direction::lines(energyMap), cols = Direction::span(energyMap);
+	const int* weighted_map = ctx.costs();
+	bool packed = ctx.parentEncoding() == ParentEncoding::Packed2;
+	size_t packedStride = packedParentStride(cols);
 
 	// Trace back the path of the minimum seam
-	int minSeam = min_element(weighted_map[rows - 1].begin(), weighted_map[rows - 1].end()) - weighted_map[rows - 1].begin();
-	vector<int> seam(rows);
+	SEAM_PROFILE_PHASE(Backtrack);
+	const int* last = weighted_map + static_cast<size_t>(rows - 1) * cols;
+	int minSeam = min_element(last, last + cols) - last;
+	vector<int>& seam = ctx.seam();
+	seam.resize(rows);
 	for (int i = rows - 1; i >= 0; i--) {
 		seam[i] = minSeam;
-		minSeam = path_table[i][minSeam];
+		if (i == 0)
+			break;
+		if (packed)
+			minSeam += unpackParent(ctx.packedParents() + i * packedStride, minSeam);
+		else
+			minSeam += ctx.parents()[static_cast<size_t>(i) * cols + minSeam];
 	}
 	return seam;
 }
 
-// Greedy algorithm to find a vertical seam
-vector<int> findVerticalSeamGreedy(const Mat& energyMap) {
-	int rows = energyMap.rows, cols = energyMap.cols;
-	vector<int> seam(rows);
-
-	// Start with the minimum energy pixel in the first row, excluding the first and last columns
-	int minSeam = min_element(energyMap.ptr<uchar>(0) + 1, energyMap.ptr<uchar>(0) + cols - 1) - energyMap.ptr<uchar>(0);
-	seam[0] = minSeam;
+// Up to count seams from one table. Every end cell, cheapest first, is traced back along its parents
+// between the nearest seams already taken on either side; where the parent would touch or cross one of
+// them the path takes the cheapest neighbour that does not, and an end cell with none left is skipped.
+// The first seam is exactly the one findSeam returns. seams comes back ordered by position.
+template <class Direction>
+static int findSeams(const Mat& energyMap, SeamFinderContext& ctx, bool forward, int count, vector<vector<int>>& seams) {
+	fillSeamTable<Direction>(energyMap, ctx, forward);
 
-	// Iterate over each row to greedily choose the next pixel in the seam
-	for (int i = 1; i < rows; i++) {
-		int prevCol = seam[i - 1];
-		int minEnergy = INT_MAX;
-		int minCol = prevCol;
+	SEAM_PROFILE_PHASE(Backtrack);
+	int rows = Direction::lines(energyMap), cols = Direction::span(energyMap);
+	const int* cost = ctx.costs();
+	const int* last = cost + static_cast<size_t>(rows - 1) * cols;
 
-		// Check the pixel directly above, and the ones to the left and right (if within bounds)
-		for (int j = max(1, prevCol - 1); j <= min(prevCol + 1, cols - 2); j++) {
-			if (energyMap.at<uchar>(i, j) < minEnergy) {
-				minEnergy = energyMap.at<uchar>(i, j);
-				minCol = j;
+	vector<int> ends(cols);
+	for (int j = 0; j < cols; j++)
+		ends[j] = j;
+	stable_sort(ends.begin(), ends.end(), [last](int a, int b) { return last[a] < last[b]; });
+
+	seams.clear();
+	vector<int> path(rows);
+	for (int end : ends) {
+		if (static_cast<int>(seams.size()) == count)
+			break;
+
+		// Neighbours in the ordering, which seams never leave since none may cross
+		auto next = lower_bound(seams.begin(), seams.end(), end, [](const vector<int>& seam, int pos) { return seam.back() < pos; });
+		if (next != seams.end() && next->back() == end)
+			continue;
+		const vector<int>* left = next == seams.begin() ? nullptr : &*(next - 1);
+		const vector<int>* right = next == seams.end() ? nullptr : &*next;
+
+		bool blocked = false;
+		int pos = end;
+		path[rows - 1] = pos;
+		for (int i = rows - 1; i > 0 && !blocked; i--) {
+			int lo = left ? (*left)[i - 1] + 1 : 0;
+			int hi = right ? (*right)[i - 1] - 1 : cols - 1;
+			int step = pos + parentAt(ctx, cols, i, pos);
+			if (step < lo || step > hi) {
+				const int* above = cost + static_cast<size_t>(i - 1) * cols;
+				step = -1;
+				for (int q = max(pos - 1, lo); q <= min(pos + 1, hi); q++)
+					if (step < 0 || above[q] < above[step])
+						step = q;
+				blocked = step < 0;
 			}
+			pos = step;
+			path[i - 1] = pos;
 		}
+		if (!blocked)
+			seams.insert(next, path);
+	}
+	return static_cast<int>(seams.size());
+}
 
-		seam[i] = minCol; // Record the column of the chosen pixel
+// How findVerticalSeamInBand decides whether to keep the band seam
+enum class BandCheck {
+	None,		// always keep it (pyramid refinement)
+	Heuristic,	// reject it along a cut-off window edge or above maxCost
+	Certified	// keep it only when no seam leaving the band can be cheaper
+};
+
+// Lower bound on the cost of every vertical seam that leaves the band, given the band's filled table.
+// Such a seam leaves it first at some row k: either it starts outside (k = 0) or it steps out of the
+// row k - 1 window, so rows before k lie in the band and cost at least the band table where it steps
+// out, row k costs at least the cheapest cell outside the row's window, and every later row at least
+// its cheapest cell. A cell costs at least its energy, or with forward energy the |r - l| every step
+// into it is charged. INT64_MAX when the band covers the whole map.
+static int64_t bandExitBound(const Mat& map, const int* cost, int cols, const vector<int>& lo, const vector<int>& hi, bool forward) {
+	int rows = map.rows;
+	const int Unset = INT_MAX;
+	vector<int> rowMin(rows), outMin(rows);
+	vector<int> cell(cols);
+	for (int i = 0; i < rows; i++) {
+		const uchar* e = map.ptr<uchar>(i);
+		if (forward) {
+			for (int j = 0; j < cols; j++)
+				cell[j] = abs(e[min(j + 1, cols - 1)] - e[max(j - 1, 0)]);
+		}
+		else {
+			for (int j = 0; j < cols; j++)
+				cell[j] = e[j];
+		}
+		int inside = Unset, outside = Unset;
+		for (int j = 0; j < lo[i]; j++)
+			outside = min(outside, cell[j]);
+		for (int j = lo[i]; j <= hi[i]; j++)
+			inside = min(inside, cell[j]);
+		for (int j = hi[i] + 1; j < cols; j++)
+			outside = min(outside, cell[j]);
+		rowMin[i] = min(inside, outside);
+		outMin[i] = outside;
 	}
 
-	return seam;
+	int64_t bound = INT64_MAX, suffix = 0;
+	for (int k = rows - 1; k >= 0; k--) {
+		if (outMin[k] != Unset) {
+			int64_t before = 0;
+			if (k > 0) {
+				// Cheapest row k - 1 band cell with a neighbour outside the row k window
+				const int* prev = cost + static_cast<size_t>(k - 1) * cols;
+				int exit = Unset;
+				for (int j = lo[k - 1]; j <= hi[k - 1]; j++)
+					if ((j >= 1 && j - 1 < lo[k]) || (j + 1 < cols && j + 1 > hi[k]))
+						exit = min(exit, prev[j]);
+				before = exit;
+			}
+			if (before != Unset)
+				bound = min(bound, before + outMin[k] + suffix);
+		}
+		suffix += rowMin[k];
+	}
+	return bound;
 }
 
-// Function to remove a vertical seam from the image
-Mat removeVerticalSeam(const Mat& img, const vector<int>& seam) {
-	Mat output(img.rows, img.cols - 1, img.type());
+// DP over the columns within radius of around in every row. Consecutive windows are at most one column
+// apart, so fencing each row's window with two blocked cells on either side keeps the unmodified row
+// kernels inside it. The check (BandCheck) decides whether the band seam is kept.
+static bool findVerticalSeamInBand(const Mat& map, SeamFinderContext& ctx, const vector<int>& around, int radius, BandCheck check, int64_t maxCost, bool forward) {
+	int rows = map.rows, cols = map.cols;
+	ctx.reserve(rows, cols);
+
+	// The band overwrites part of the table, nothing of it can be kept
+	ctx.invalidateTable();
+
+	const int Blocked = INT_MAX / 2;
+	int* cost = ctx.costs();
+	schar* parent = ctx.parents();
+	auto window = [&](int i, int& lo, int& hi) {
+		lo = max(around[i] - radius, 0);
+		hi = min(around[i] + radius, cols - 1);
+	};
 
-	for (int i = 0; i < img.rows; ++i)
 	{
-		int col = seam[i];
-		for (int j = 0; j < col; ++j)
-		{
-			output.at<Vec3b>(i, j) = img.at<Vec3b>(i, j);
-		}
-		for (int j = col + 1; j < img.cols; ++j) {
-			output.at<Vec3b>(i, j - 1) = img.at<Vec3b>(i, j);
+		SEAM_PROFILE_PHASE(DPFill);
+		DPRowKernel fillRow = getDPRowKernel();
+		ForwardRowKernel fillForwardRow = getForwardRowKernel();
+		size_t cells = 0;
+		for (int i = 0; i < rows; i++) {
+			int lo, hi;
+			window(i, lo, hi);
+			int* cur = cost + static_cast<size_t>(i) * cols;
+			const uchar* e = map.ptr<uchar>(i);
+			if (i == 0) {
+				if (forward)
+					forwardFirstRow(e, cur, cols, lo, hi + 1);
+				else
+					copy(e + lo, e + hi + 1, cur + lo);
+			}
+			else if (forward)
+				fillForwardRow(cur - cols, map.ptr<uchar>(i - 1), e, cur, parent + static_cast<size_t>(i) * cols, cols, lo, hi + 1);
+			else
+				fillRow(cur - cols, e, cur, parent + static_cast<size_t>(i) * cols, cols, lo, hi + 1);
+
+			for (int j = max(lo - 2, 0); j < lo; j++)
+				cur[j] = Blocked;
+			for (int j = hi + 1; j <= min(hi + 2, cols - 1); j++)
+				cur[j] = Blocked;
+			cells += hi - lo + 1;
 		}
+		SEAM_PROFILE_COUNT(DPCells, cells);
 	}
 
-	return output;
+	int lo, hi;
+	window(rows - 1, lo, hi);
+	const int* last = cost + static_cast<size_t>(rows - 1) * cols;
+	int minSeam = min_element(last + lo, last + hi + 1) - last;
+	if (check == BandCheck::Heuristic && last[minSeam] > maxCost)
+		return false;
+	if (check == BandCheck::Certified) {
+		SEAM_PROFILE_PHASE(BandBound);
+		vector<int> los(rows), his(rows);
+		for (int i = 0; i < rows; i++)
+			window(i, los[i], his[i]);
+		if (last[minSeam] > bandExitBound(map, cost, cols, los, his, forward))
+			return false;
+	}
+
+	SEAM_PROFILE_PHASE(Backtrack);
+	vector<int>& seam = ctx.seam();
+	seam.resize(rows);
+	for (int i = rows - 1; i >= 0; i--) {
+		window(i, lo, hi);
+		if (check == BandCheck::Heuristic && ((minSeam == lo && lo > 0) || (minSeam == hi && hi < cols - 1)))
+			return false;
+		seam[i] = minSeam;
+		if (i > 0)
+			minSeam += parent[static_cast<size_t>(i) * cols + minSeam];
+	}
+	return true;
 }
 
-// Function to draw a vertical seam on the image
-void drawVerticalSeam(Mat& img, const vector<int>& seam)
-{
-	for (int i = 0; i < img.rows; i++) {
-		// Ensure seam[i] is within valid column indices for img
-		if (seam[i] >= 0 && seam[i] < img.cols) {
-			img.at<Vec3b>(i, seam[i]) = Vec3b(0, 0, 255); // Set seam pixels to red
+// Sum of the map along a seam, or with forward energy the forward cost the DP charged for it
+template <class Direction>
+static int64_t seamCost(const Mat& map, const vector<int>& seam, bool forward) {
+	int lines = Direction::lines(map), span = Direction::span(map);
+	int64_t total = 0;
+	for (int k = 0; k < lines; k++) {
+		int p = seam[k];
+		if (!forward) {
+			total += Direction::template at<uchar>(map, k, p);
+			continue;
 		}
-		else {
-			cerr << "Warning: seam index out of bounds at row " << i << ": " << seam[i] << endl;
+		int l = Direction::template at<uchar>(map, k, max(p - 1, 0));
+		int r = Direction::template at<uchar>(map, k, min(p + 1, span - 1));
+		total += abs(r - l);
+		if (k > 0 && seam[k - 1] != p) {
+			// A sideways step also joins the pixel before it with the one next to the seam
+			int u = Direction::template at<uchar>(map, k - 1, p);
+			total += abs(u - (seam[k - 1] < p ? l : r));
 		}
 	}
+	return total;
 }
 
+// Greedy algorithm: follow the cheapest of the three neighbours from line to line
+template <class Direction>
+static vector<int> findSeamGreedy(const Mat& energyMap) {
+	SEAM_PROFILE_PHASE(Greedy);
+	int lines = Direction::lines(energyMap), span = Direction::span(energyMap);
+	vector<int> seam(lines);
+
+	// Start with the minimum energy pixel in the first line, excluding the first and last positions
+	int minSeam = 1;
+	for (int p = 2; p < span - 1; p++)
+		if (Direction::template at<uchar>(energyMap, 0, p) < Direction::template at<uchar>(energyMap, 0, minSeam))
+			minSeam = p;
+	seam[0] = minSeam;
 
-// Function to find the minimum horizontal seam
-vector<int> findHorizontalSeam(const Mat& energyMap) {
-	int rows = energyMap.rows, cols = energyMap.cols;
-	vector<vector<int>> weighted_map(rows, vector<int>(cols, 0));
-	vector<vector<int>> path_table(rows, vector<int>(cols, 0));
+	// Iterate over each line to greedily choose the next pixel in the seam
+	for (int k = 1; k < lines; k++) {
+		int prevPos = seam[k - 1];
+		int minEnergy = INT_MAX;
+		int minPos = prevPos;
+
+		// Check the pixel next to the previous one, and its two neighbours (if within bounds)
+		for (int p = max(1, prevPos - 1); p <= min(prevPos + 1, span - 2); p++) {
+			int energy = Direction::template at<uchar>(energyMap, k, p);
+			if (energy < minEnergy) {
+				minEnergy = energy;
+				minPos = p;
+			}
+		}
 
-	// Initialize the weighted_map table with the first column of energy values
-	for (int i = 0; i < rows; i++)
-		weighted_map[i][0] = energyMap.at<uchar>(i, 0);
+		seam[k] = minPos; // Record the position of the chosen pixel
+	}
 
-	// Fill the weighted_map table
-	for (int j = 1; j < cols; j++) {
-		for (int i = 0; i < rows; i++) {
-			weighted_map[i][j] = weighted_map[i][j - 1];
-			path_table[i][j] = i;
+	return seam;
+}
+
+static atomic<int> parallelGrain(1 << 16);
 
-			if (i > 0 && weighted_map[i - 1][j - 1] < weighted_map[i][j]) {
-				weighted_map[i][j] = weighted_map[i - 1][j - 1];
-				path_table[i][j] = i - 1;
+void setSeamParallelGrain(int pixels) {
+	parallelGrain = pixels;
+}
+
+int getSeamParallelGrain() {
+	return parallelGrain;
+}
+
+// body(first, last) over the items [0, count) of itemPixels pixels each, split with cv::parallel_for_
+// into tasks of at least the grain (and a multiple of align items), and into no more than threads tasks
+// when threads > 0; small jobs and a budget of one thread stay on this thread
+template <class Body>
+static void forEachRange(int count, size_t itemPixels, int align, int threads, Body body) {
+	int grain = parallelGrain;
+	size_t items = grain > 0 ? (grain + itemPixels - 1) / max(itemPixels, size_t(1)) : count;
+	if (threads > 0)
+		items = max(items, (static_cast<size_t>(count) + threads - 1) / threads);
+	int perTask = static_cast<int>(std::min(items, static_cast<size_t>(count)));
+	perTask = max((perTask + align - 1) / align * align, 1);
+	int tasks = (count + perTask - 1) / perTask;
+	if (tasks < 2 || (threads > 0 ? threads : getNumThreads()) < 2) {
+		body(0, count);
+		return;
+	}
+	parallel_for_(Range(0, tasks), [&](const Range& range) {
+		body(range.start * perTask, min(range.end * perTask, count));
+	}, tasks);
+}
+
+// Copy src without the seam into dst, which is one column (row) smaller and may share src's buffer.
+// PixelSize is the pixel size in bytes, or 0 for "read it from src" for uncommon types.
+template <size_t PixelSize>
+static void carveSeam(VerticalSeam, const Mat& src, Mat& dst, const vector<int>& seam, int threads) {
+	size_t pixelSize = PixelSize ? PixelSize : src.elemSize();
+
+	// Per row: the part left of the seam stays (nothing to do in place), the tail moves left by one.
+	// Rows are independent, so blocks of them go to different threads.
+	forEachRange(src.rows, src.cols, 1, threads, [&](int first, int last) {
+		for (int i = first; i < last; i++) {
+			const uchar* from = src.ptr<uchar>(i);
+			uchar* to = dst.ptr<uchar>(i);
+			int col = seam[i];
+			if (to != from)
+				memcpy(to, from, col * pixelSize);
+			memmove(to + col * pixelSize, from + (col + 1) * pixelSize, (src.cols - col - 1) * pixelSize);
+		}
+	});
+}
+
+// Walking row by row, output row i takes source row i in the columns whose seam lies below i and source
+// row i + 1 in the others. Those columns come in runs, and each run is one memcpy, so the image is read
+// and written in memory order. In place, runs that would copy a row onto itself are skipped.
+// In place, row i is overwritten while row i - 1 still needs it, so the threads split the columns
+// instead of the rows: every strip walks all rows top to bottom on its own.
+template <size_t PixelSize>
+static void carveSeam(HorizontalSeam, const Mat& src, Mat& dst, const vector<int>& seam, int threads) {
+	size_t pixelSize = PixelSize ? PixelSize : src.elemSize();
+
+	forEachRange(src.cols, src.rows, 16, threads, [&](int first, int last) {
+		int top = *min_element(seam.begin() + first, seam.begin() + last);
+		for (int i = 0; i < src.rows - 1; i++) {
+			const uchar* same = src.ptr<uchar>(i);
+			const uchar* below = src.ptr<uchar>(i + 1);
+			uchar* to = dst.ptr<uchar>(i);
+
+			// Above the topmost seam position every column keeps its own row
+			if (i < top) {
+				if (to != same)
+					memcpy(to + first * pixelSize, same + first * pixelSize, (last - first) * pixelSize);
+				continue;
 			}
-			if (i < rows - 1 && weighted_map[i + 1][j - 1] < weighted_map[i][j]) {
-				weighted_map[i][j] = weighted_map[i + 1][j - 1];
-				path_table[i][j] = i + 1;
+
+			for (int j = first; j < last;) {
+				int start = j;
+				bool keep = seam[j] > i;
+				while (j < last && (seam[j] > i) == keep)
+					j++;
+				const uchar* from = keep ? same : below;
+				if (to != from)
+					memcpy(to + start * pixelSize, from + start * pixelSize, (j - start) * pixelSize);
 			}
-			weighted_map[i][j] += energyMap.at<uchar>(i, j);
 		}
-	}
+	});
+}
 
-	// Trace back the path of the minimum seam
-	int minSeam = min_element(weighted_map.begin(), weighted_map.end(),
-		[&](const vector<int>& a, const vector<int>& b) { return a[cols - 1] < b[cols - 1]; }) - weighted_map.begin();
-	vector<int> seam(cols);
-	for (int j = cols - 1; j >= 0; j--) {
-		seam[j] = minSeam;
-		minSeam = path_table[minSeam][j];
+// Pick the instantiation for the pixel size once, outside the row loops
+template <class Direction>
+static void carveSeamAnyPixel(const Mat& src, Mat& dst, const vector<int>& seam, int threads) {
+	CV_Assert(static_cast<int>(seam.size()) == Direction::lines(src) && Direction::span(src) > 1);
+	switch (src.elemSize()) {
+	case 1: carveSeam<1>(Direction(), src, dst, seam, threads); break;	// 8UC1
+	case 2: carveSeam<2>(Direction(), src, dst, seam, threads); break;	// 16UC1
+	case 3: carveSeam<3>(Direction(), src, dst, seam, threads); break;	// 8UC3
+	case 4: carveSeam<4>(Direction(), src, dst, seam, threads); break;	// 8UC4, 32FC1
+	case 6: carveSeam<6>(Direction(), src, dst, seam, threads); break;	// 16UC3
+	case 8: carveSeam<8>(Direction(), src, dst, seam, threads); break;	// 16UC4
+	case 12: carveSeam<12>(Direction(), src, dst, seam, threads); break;	// 32FC3
+	case 16: carveSeam<16>(Direction(), src, dst, seam, threads); break;	// 32FC4
+	default: carveSeam<0>(Direction(), src, dst, seam, threads); break;
 	}
-	return seam;
 }
 
+template <class Direction>
+static Mat removeSeam(const Mat& img, const vector<int>& seam, int threads) {
+	Mat output(Direction::narrowed(img).size(), img.type());
+	carveSeamAnyPixel<Direction>(img, output, seam, threads);
+	return output;
+}
 
-// Greedy algorithm to find a horizontal seam
-vector<int> findHorizontalSeamGreedy(const Mat& energyMap) {
-	int rows = energyMap.rows, cols = energyMap.cols;
-	vector<int> seam(cols);
+template <class Direction>
+static void removeSeamInPlace(Mat& img, const vector<int>& seam, int threads) {
+	Mat output = Direction::narrowed(img);
+	carveSeamAnyPixel<Direction>(img, output, seam, threads);
+	img = output;
+}
 
-	// Start with the minimum energy pixel in the first column, excluding the first and last rows
-	int minSeam = min_element(energyMap.col(0).ptr<uchar>() + 1, energyMap.col(0).ptr<uchar>() + rows - 1) - energyMap.col(0).ptr<uchar>();
-	seam[0] = minSeam;
+// The same seam out of several planes in place, in one pass over the rows: the seam position (vertical)
+// or the runs of the row (horizontal) are worked out once per row and applied to every plane; threads
+// split the rows (vertical) or the columns (horizontal) as in carveSeam
+static void carvePlanes(VerticalSeam, Mat* planes, size_t count, const vector<int>& seam, int threads) {
+	int rows = planes[0].rows, cols = planes[0].cols;
+	forEachRange(rows, cols * count, 1, threads, [&](int first, int last) {
+		for (int i = first; i < last; i++) {
+			int col = seam[i];
+			for (size_t p = 0; p < count; p++) {
+				size_t pixelSize = planes[p].elemSize();
+				uchar* row = planes[p].ptr<uchar>(i);
+				memmove(row + col * pixelSize, row + (col + 1) * pixelSize, (cols - col - 1) * pixelSize);
+			}
+		}
+	});
+}
 
-	// Iterate over each column to greedily choose the next pixel in the seam
-	for (int j = 1; j < cols; j++) {
-		int prevRow = seam[j - 1];
-		int minEnergy = INT_MAX;
-		int minRow = prevRow;
+static void carvePlanes(HorizontalSeam, Mat* planes, size_t count, const vector<int>& seam, int threads) {
+	int rows = planes[0].rows, cols = planes[0].cols;
+	forEachRange(cols, rows * count, 16, threads, [&](int first, int last) {
+		int top = *min_element(seam.begin() + first, seam.begin() + last);
+		for (int i = top; i < rows - 1; i++) {
+			for (int j = first; j < last;) {
+				if (seam[j] > i) {
+					j++;
+					continue;
+				}
+				int start = j;
+				while (j < last && seam[j] <= i)
+					j++;
+				for (size_t p = 0; p < count; p++) {
+					size_t pixelSize = planes[p].elemSize();
+					memcpy(planes[p].ptr<uchar>(i) + start * pixelSize, planes[p].ptr<uchar>(i + 1) + start * pixelSize, (j - start) * pixelSize);
+				}
+			}
+		}
+	});
+}
+
+template <class Direction>
+static void removeSeamInPlace(vector<Mat>& planes, const vector<int>& seam, int threads) {
+	CV_Assert(!planes.empty());
+	for (const Mat& plane : planes)
+		CV_Assert(plane.size() == planes[0].size() && plane.dims == 2);
+	CV_Assert(static_cast<int>(seam.size()) == Direction::lines(planes[0]) && Direction::span(planes[0]) > 1);
 
-		// Check the pixel directly left, and the ones above and below (if within bounds)
-		for (int i = max(1, prevRow - 1); i <= min(prevRow + 1, rows - 2); i++) {
-			if (energyMap.at<uchar>(i, j) < minEnergy) {
-				minEnergy = energyMap.at<uchar>(i, j);
-				minRow = i;
+	carvePlanes(Direction(), planes.data(), planes.size(), seam, threads);
+	for (Mat& plane : planes)
+		plane = Direction::narrowed(plane);
+}
+
+// Several vertical seams at once, ordered left to right and all in the planes' current coordinates: per
+// row the kept runs between the seam pixels move left in one sweep, so every pixel moves only once
+static void removeVerticalSeamsInPlace(Mat* planes, size_t count, const vector<vector<int>>& seams, int threads) {
+	for (size_t p = 0; p < count; p++)
+		CV_Assert(planes[p].size() == planes[0].size() && planes[p].dims == 2);
+	int rows = planes[0].rows, cols = planes[0].cols, k = static_cast<int>(seams.size());
+	CV_Assert(k < cols);
+	for (const vector<int>& seam : seams)
+		CV_Assert(static_cast<int>(seam.size()) == rows);
+
+	for (int i = 0; i < rows; i++)
+		for (int m = 1; m < k; m++)
+			CV_Assert(seams[m - 1][i] < seams[m][i]);
+
+	forEachRange(rows, cols * count, 1, threads, [&](int first, int last) {
+		for (int i = first; i < last; i++) {
+			for (size_t p = 0; p < count; p++) {
+				size_t pixelSize = planes[p].elemSize();
+				uchar* row = planes[p].ptr<uchar>(i);
+				uchar* to = row + seams[0][i] * pixelSize;
+				for (int m = 0; m < k; m++) {
+					int start = seams[m][i] + 1, end = m + 1 < k ? seams[m + 1][i] : cols;
+					memmove(to, row + start * pixelSize, (end - start) * pixelSize);
+					to += (end - start) * pixelSize;
+				}
 			}
 		}
+	});
+	for (size_t p = 0; p < count; p++)
+		planes[p] = planes[p].colRange(0, cols - k);
+}
 
-		seam[j] = minRow; // Record the row of the chosen pixel
+// Colour the seam pixels, warning about (and skipping) positions outside the image
+template <class Direction, typename Pixel>
+static void drawSeam(Mat& img, const vector<int>& seam, const Pixel& color) {
+	int lines = Direction::lines(img), span = Direction::span(img);
+	for (int k = 0; k < lines; k++) {
+		// Ensure seam[k] is within valid positions for img
+		if (seam[k] >= 0 && seam[k] < span) {
+			Direction::template at<Pixel>(img, k, seam[k]) = color;
+		}
+		else {
+			cerr << "Warning: seam index out of bounds at " << Direction::lineName << " " << k << ": " << seam[k] << endl;
+		}
 	}
+}
 
-	return seam;
+// Red for colour images (opaque with alpha), white for gray ones, at full scale for the depth
+template <class Direction, typename T>
+static void drawSeamDepth(Mat& img, const vector<int>& seam, T fullScale) {
+	switch (img.channels()) {
+	case 1: drawSeam<Direction>(img, seam, fullScale); break;
+	case 3: drawSeam<Direction>(img, seam, Vec<T, 3>(0, 0, fullScale)); break;
+	case 4: drawSeam<Direction>(img, seam, Vec<T, 4>(0, 0, fullScale, fullScale)); break;
+	default: CV_Error(Error::StsUnsupportedFormat, "seams can only be drawn on images with 1, 3 or 4 channels");
+	}
 }
 
-// Function to remove a horizontal seam from the image
-Mat removeHorizontalSeam(const Mat& img, const vector<int>& seam) {
-	Mat output(img.rows - 1, img.cols, img.type());
+template <class Direction>
+static void drawSeamAnyPixel(Mat& img, const vector<int>& seam) {
+	switch (img.depth()) {
+	case CV_8U: drawSeamDepth<Direction>(img, seam, uchar(255)); break;
+	case CV_16U: drawSeamDepth<Direction>(img, seam, ushort(65535)); break;
+	case CV_32F: drawSeamDepth<Direction>(img, seam, 1.f); break;
+	default: CV_Error(Error::StsUnsupportedFormat, "seams can only be drawn on 8-bit, 16-bit or float images");
+	}
+}
 
-	for (int j = 0; j < img.cols; ++j) {
-		int row = seam[j];
-		for (int i = 0; i < row; ++i) {
-			output.at<Vec3b>(i, j) = img.at<Vec3b>(i, j);
+// Function to find the minimum vertical seam
+vector<int> findVerticalSeam(const Mat& energyMap) {
+	SeamFinderContext ctx;
+	return findVerticalSeam(energyMap, ctx);
+}
+
+// Same as above, but the DP tables and the returned seam live in ctx and are reused between calls
+const vector<int>& findVerticalSeam(const Mat& energyMap, SeamFinderContext& ctx) {
+	return findSeam<VerticalSeam>(energyMap, ctx, false);
+}
+
+// Forward energy DP on the luma map, seam and tables in ctx
+const vector<int>& findVerticalSeamForward(const Mat& luma, SeamFinderContext& ctx) {
+	return findSeam<VerticalSeam>(luma, ctx, true);
+}
+
+// Several non-crossing seams from one DP table, see findSeams
+int findVerticalSeams(const Mat& map, SeamFinderContext& ctx, int count, vector<vector<int>>& seams, bool forward) {
+	CV_Assert(count >= 1);
+	return findSeams<VerticalSeam>(map, ctx, forward, count, seams);
+}
+
+// Function to measure what a vertical seam costs in the energy the DP runs on
+int64_t verticalSeamCost(const Mat& map, const vector<int>& seam, bool forward) {
+	return seamCost<VerticalSeam>(map, seam, forward);
+}
+
+// Banded search around a previous seam, see findVerticalSeamInBand
+static bool findVerticalSeamBanded(const Mat& map, SeamFinderContext& ctx, const vector<int>& around, int radius, BandCheck check, int64_t maxCost, bool forward) {
+	CV_Assert(static_cast<int>(around.size()) == map.rows && radius >= 1);
+	for (int i = 1; i < map.rows; i++)
+		CV_Assert(abs(around[i] - around[i - 1]) <= 1);
+
+	// Only worth it (and only supported) when the band is narrower than the map, with full parent rows
+	if (2 * radius + 1 >= map.cols || ctx.parentEncoding() != ParentEncoding::Offset8)
+		return false;
+	return findVerticalSeamInBand(map, ctx, around, radius, check, maxCost, forward);
+}
+
+// Function to find the cheapest vertical seam within a band, only when it is provably the cheapest overall
+bool findVerticalSeamBanded(const Mat& map, SeamFinderContext& ctx, const vector<int>& around, int radius, bool forward) {
+	return findVerticalSeamBanded(map, ctx, around, radius, BandCheck::Certified, 0, forward);
+}
+
+// Function to find the cheapest vertical seam within a band, with the cheap heuristic checks only
+bool findVerticalSeamBandedApprox(const Mat& map, SeamFinderContext& ctx, const vector<int>& around, int radius, int64_t maxCost, bool forward) {
+	return findVerticalSeamBanded(map, ctx, around, radius, BandCheck::Heuristic, maxCost, forward);
+}
+
+// Coarse-to-fine search: the full DP runs on the coarsest pyrDown level only; every finer level then
+// runs it within corridor columns of the seam from the level below, stretched to the finer level
+const vector<int>& findVerticalSeamPyramid(const Mat& map, SeamFinderContext& ctx, int levels, int corridor, bool forward) {
+	CV_Assert(levels >= 0 && corridor >= 1);
+	if (ctx.parentEncoding() != ParentEncoding::Offset8)
+		return findSeam<VerticalSeam>(map, ctx, forward);
+
+	// Halve the map while the corridor stays narrower than the level above
+	int depth = 0;
+	{
+		SEAM_PROFILE_PHASE(Pyramid);
+		Mat finer = map;
+		while (depth < levels && finer.rows >= 2 && (finer.cols + 1) / 2 > 2 * corridor + 1) {
+			Mat& coarser = ctx.pyramidLevel(depth, Size((finer.cols + 1) / 2, (finer.rows + 1) / 2));
+			pyrDown(finer, coarser, coarser.size());
+			finer = coarser;
+			depth++;
 		}
-		for (int i = row + 1; i < img.rows; ++i) {
-			output.at<Vec3b>(i - 1, j) = img.at<Vec3b>(i, j);
+	}
+	if (depth == 0)
+		return findSeam<VerticalSeam>(map, ctx, forward);
+
+	findSeam<VerticalSeam>(ctx.pyramidLevel(depth - 1), ctx, forward);
+	for (int level = depth - 1; level >= 0; level--) {
+		const Mat& finer = level == 0 ? map : ctx.pyramidLevel(level - 1);
+		const vector<int>& coarse = ctx.seam();
+
+		// Row 2i lies under coarse row i and row 2i + 1 halfway to the next, which keeps the stretched
+		// seam 8-connected
+		vector<int>& around = ctx.corridor();
+		around.resize(finer.rows);
+		int last = static_cast<int>(coarse.size()) - 1;
+		for (int i = 0; i < finer.rows; i++) {
+			int k = i / 2;
+			around[i] = i % 2 ? coarse[k] + coarse[min(k + 1, last)] : 2 * coarse[k];
+			around[i] = min(around[i], finer.cols - 1);
 		}
+		findVerticalSeamInBand(finer, ctx, around, corridor, BandCheck::None, 0, forward);
 	}
+	SEAM_PROFILE_COUNT(PyramidSeams, 1);
+	return ctx.seam();
+}
 
-	return output;
+// Greedy algorithm to find a vertical seam
+vector<int> findVerticalSeamGreedy(const Mat& energyMap) {
+	return findSeamGreedy<VerticalSeam>(energyMap);
+}
+
+// Function to remove a vertical seam from the image
+Mat removeVerticalSeam(const Mat& img, const vector<int>& seam, int threads) {
+	return removeSeam<VerticalSeam>(img, seam, threads);
+}
+
+// Function to remove a vertical seam without reallocating: one memmove per row closes the gap
+void removeVerticalSeamInPlace(Mat& img, const vector<int>& seam, int threads) {
+	removeSeamInPlace<VerticalSeam>(img, seam, threads);
+}
+
+// Function to remove a vertical seam from several aligned planes at once
+void removeVerticalSeamInPlace(vector<Mat>& planes, const vector<int>& seam, int threads) {
+	removeSeamInPlace<VerticalSeam>(planes, seam, threads);
+}
+
+// Function to remove a batch of vertical seams in one pass over the rows
+void removeVerticalSeamsInPlace(Mat& img, const vector<vector<int>>& seams, int threads) {
+	removeVerticalSeamsInPlace(&img, 1, seams, threads);
+}
+
+void removeVerticalSeamsInPlace(vector<Mat>& planes, const vector<vector<int>>& seams, int threads) {
+	CV_Assert(!planes.empty());
+	removeVerticalSeamsInPlace(planes.data(), planes.size(), seams, threads);
+}
+
+// Function to draw a vertical seam on the image
+void drawVerticalSeam(Mat& img, const vector<int>& seam) {
+	drawSeamAnyPixel<VerticalSeam>(img, seam);
+}
+
+
+// Function to find the minimum horizontal seam
+vector<int> findHorizontalSeam(const Mat& energyMap) {
+	SeamFinderContext ctx;
+	return findHorizontalSeam(energyMap, ctx);
+}
+
+// Same as above, but the DP tables and the returned seam live in ctx and are reused between calls
+const vector<int>& findHorizontalSeam(const Mat& energyMap, SeamFinderContext& ctx) {
+	return findSeam<HorizontalSeam>(energyMap, ctx, false);
+}
+
+// Forward energy DP on the luma map, seam and tables in ctx
+const vector<int>& findHorizontalSeamForward(const Mat& luma, SeamFinderContext& ctx) {
+	return findSeam<HorizontalSeam>(luma, ctx, true);
+}
+
+// Function to measure what a horizontal seam costs in the energy the DP runs on
+int64_t horizontalSeamCost(const Mat& map, const vector<int>& seam, bool forward) {
+	return seamCost<HorizontalSeam>(map, seam, forward);
+}
+
+// Greedy algorithm to find a horizontal seam
+vector<int> findHorizontalSeamGreedy(const Mat& energyMap) {
+	return findSeamGreedy<HorizontalSeam>(energyMap);
+}
+
+// Function to remove a horizontal seam from the image
+Mat removeHorizontalSeam(const Mat& img, const vector<int>& seam, int threads) {
+	return removeSeam<HorizontalSeam>(img, seam, threads);
+}
+
+// Function to remove a horizontal seam without reallocating, row by row in memory order
+void removeHorizontalSeamInPlace(Mat& img, const vector<int>& seam, int threads) {
+	removeSeamInPlace<HorizontalSeam>(img, seam, threads);
+}
+
+// Function to remove a horizontal seam from several aligned planes at once
+void removeHorizontalSeamInPlace(vector<Mat>& planes, const vector<int>& seam, int threads) {
+	removeSeamInPlace<HorizontalSeam>(planes, seam, threads);
 }
 
 // Function to draw a horizontal seam on the image
 void drawHorizontalSeam(Mat& img, const vector<int>& seam) {
-	for (int j = 0; j < img.cols; j++) {
-		// Ensure seam[j] is within valid row indices for img
-		if (seam[j] >= 0 && seam[j] < img.rows) {
-			img.at<Vec3b>(seam[j], j) = Vec3b(0, 0, 255); // Set seam pixels to red
-		}
-		else {
-			cerr << "Warning: seam index out of bounds at column " << j << ": " << seam[j] << endl;
-		}
-	}
+	drawSeamAnyPixel<HorizontalSeam>(img, seam);
 }
+
+} // namespace seam
@@ -1,26 +1,75 @@
 #pragma once
 #include <opencv2/core.hpp>
-#include <opencv2/imgcodecs.hpp>
-#include <opencv2/highgui.hpp>
-#include <opencv2/imgproc.hpp>
-#include "SeamCarving.h"
-#include <iostream>
+#include "SeamFinderContext.h"
+#include <cstdint>
 #include <vector>
-#include <limits>
 
-using namespace cv;
-using namespace std;
+namespace seam {
 
-Mat calculateEnergyMap(const Mat& img);
+cv::Mat calculateEnergyMap(const cv::Mat& img);
+
+// The *InPlace removals work on any pixel type: they shift pixels inside img's own buffer and
+// then narrow img to a ROI header one column (row) smaller, keeping the original step. Anything
+// else sharing the buffer sees the shifted pixels. Clone the result to get a compact Mat.
+// The vector overloads remove the same seam from planes of equal size but any types (e.g. an image
+// with its alpha matte, mask and depth) in a single pass over the rows.
+
+// Removal splits its rows (columns for horizontal removal) over cv::parallel_for_ in tasks of at least
+// setSeamParallelGrain pixels; 0 keeps it on the calling thread, as do images smaller than two tasks and
+// a cv::setNumThreads of 1. A removal's threads argument overrides cv::getNumThreads for that call only:
+// it runs at most that many tasks, and 1 stays on the calling thread. Drawing writes one pixel per line
+// and always stays on the calling thread.
+void setSeamParallelGrain(int pixels);
+int getSeamParallelGrain();
+
+// The *Forward finders use forward energy: they take the 8-bit luma of the image (computeLumaMap)
+// instead of an energy map and charge every step the intensity differences it creates.
+
+// Batches: findVerticalSeams takes up to count non-crossing seams from a single DP table (the first is
+// the findVerticalSeam seam, the others the cheapest paths that fit between the seams already taken),
+// ordered left to right and all in the map's coordinates; removeVerticalSeamsInPlace removes such a
+// batch in one pass. The *SeamCost functions give what a seam costs in the energy the DP runs on.
+
+// findVerticalSeamBanded runs the DP only within radius columns of around (e.g. the previous seam, which
+// must be 8-connected) and leaves the seam in ctx.seam(). It returns true only when the band seam is
+// provably a cheapest seam of the whole map: its cost is no higher than a lower bound on every seam that
+// leaves the band (the band table where the seam steps out, then the per-row minimum costs), which takes
+// one read-only pass over the map. findVerticalSeamBandedApprox skips that pass and returns false only
+// when the band seam runs along a band edge that is not the image border or costs more than maxCost; its
+// seams are approximate, like the pyramid ones. Offset8 parents only; the kept incremental table is
+// dropped.
+
+// findVerticalSeamPyramid halves the map up to levels times with pyrDown, runs the full DP on the
+// coarsest level and refines the seam on every finer level within corridor columns of the one below.
+// Close to, but not always, the findVerticalSeam seam, for a fraction of the DP cells. Levels that
+// would leave fewer than 2 * corridor + 2 columns are skipped; Packed2 runs the full DP.
 
 // Vertical
-vector<int> findVerticalSeam(const Mat& energyMap);
-vector<int> findVerticalSeamGreedy(const Mat& energyMap);
-Mat removeVerticalSeam(const Mat& img, const vector<int>& seam);
-void drawVerticalSeam(Mat& img, const vector<int>& seam);
+std::vector<int> findVerticalSeam(const cv::Mat& energyMap);
+const std::vector<int>& findVerticalSeam(const cv::Mat& energyMap, SeamFinderContext& ctx);
+std::vector<int> findVerticalSeamGreedy(const cv::Mat& energyMap);
+const std::vector<int>& findVerticalSeamForward(const cv::Mat& luma, SeamFinderContext& ctx);
+bool findVerticalSeamBanded(const cv::Mat& map, SeamFinderContext& ctx, const std::vector<int>& around, int radius, bool forward = false);
+bool findVerticalSeamBandedApprox(const cv::Mat& map, SeamFinderContext& ctx, const std::vector<int>& around, int radius, int64_t maxCost, bool forward = false);
+const std::vector<int>& findVerticalSeamPyramid(const cv::Mat& map, SeamFinderContext& ctx, int levels, int corridor, bool forward = false);
+int findVerticalSeams(const cv::Mat& map, SeamFinderContext& ctx, int count, std::vector<std::vector<int>>& seams, bool forward = false);
+int64_t verticalSeamCost(const cv::Mat& map, const std::vector<int>& seam, bool forward = false);
+cv::Mat removeVerticalSeam(const cv::Mat& img, const std::vector<int>& seam, int threads = 0);
+void removeVerticalSeamInPlace(cv::Mat& img, const std::vector<int>& seam, int threads = 0);
+void removeVerticalSeamInPlace(std::vector<cv::Mat>& planes, const std::vector<int>& seam, int threads = 0);
+void removeVerticalSeamsInPlace(cv::Mat& img, const std::vector<std::vector<int>>& seams, int threads = 0);
+void removeVerticalSeamsInPlace(std::vector<cv::Mat>& planes, const std::vector<std::vector<int>>& seams, int threads = 0);
+void drawVerticalSeam(cv::Mat& img, const std::vector<int>& seam);
 
 // Horizontal
-vector<int> findHorizontalSeam(const Mat& energyMap);
-vector<int> findHorizontalSeamGreedy(const Mat& energyMap);
-Mat removeHorizontalSeam(const Mat& img, const vector<int>& seam);
-void drawHorizontalSeam(Mat& img, const vector<int>& seam);
\ No newline at end of file
+std::vector<int> findHorizontalSeam(const cv::Mat& energyMap);
+const std::vector<int>& findHorizontalSeam(const cv::Mat& energyMap, SeamFinderContext& ctx);
+std::vector<int> findHorizontalSeamGreedy(const cv::Mat& energyMap);
+const std::vector<int>& findHorizontalSeamForward(const cv::Mat& luma, SeamFinderContext& ctx);
+int64_t horizontalSeamCost(const cv::Mat& map, const std::vector<int>& seam, bool forward = false);
+cv::Mat removeHorizontalSeam(const cv::Mat& img, const std::vector<int>& seam, int threads = 0);
+void removeHorizontalSeamInPlace(cv::Mat& img, const std::vector<int>& seam, int threads = 0);
+void removeHorizontalSeamInPlace(std::vector<cv::Mat>& planes, const std::vector<int>& seam, int threads = 0);
+void drawHorizontalSeam(cv::Mat& img, const std::vector<int>& seam);
+
+} // namespace seam
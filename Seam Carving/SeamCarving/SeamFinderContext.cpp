@@ -0,0 +1,92 @@
+#include "SeamFinderContext.h"
+#include "DPKernels.h"
+#include <algorithm>
+
+namespace seam {
+
+void SeamFinderContext::reserve(int rows, int cols) {
+	size_t cells = static_cast<size_t>(rows) * static_cast<size_t>(cols);
+
+	// A seam is rows long when vertical and cols long when horizontal
+	size_t seamLength = static_cast<size_t>(std::max(rows, cols));
+
+	if (cost.reserve(cells))
+		allocations++;
+
+	if (encoding == ParentEncoding::Offset8) {
+		if (parent.reserve(cells))
+			allocations++;
+	}
+	else {
+		// Scratch line for the kernels plus the packed table, which may be walked in either direction
+		if (parent.reserve(seamLength))
+			allocations++;
+		if (packed.reserve(parentTableBytes(rows, cols)))
+			allocations++;
+	}
+
+	if (seamBuffer.capacity() < seamLength) {
+		seamBuffer.reserve(seamLength);
+		allocations++;
+	}
+	if (removed.capacity() < seamLength) {
+		removed.reserve(seamLength);
+		allocations++;
+	}
+}
+
+cv::Mat& SeamFinderContext::pyramidLevel(int level, cv::Size size) {
+	if (static_cast<int>(levels.size()) <= level) {
+		levelBuffers.resize(level + 1);
+		levels.resize(level + 1);
+	}
+	cv::Mat& buffer = levelBuffers[level];
+	if (buffer.rows < size.height || buffer.cols < size.width) {
+		buffer.create(std::max(buffer.rows, size.height), std::max(buffer.cols, size.width), CV_8UC1);
+		allocations++;
+	}
+	levels[level] = buffer(cv::Rect(0, 0, size.width, size.height));
+	return levels[level];
+}
+
+void SeamFinderContext::setIncremental(bool enabled, double maxConeFraction) {
+	incrementalEnabled = enabled;
+	coneLimit = maxConeFraction;
+	invalidateTable();
+}
+
+void SeamFinderContext::verticalSeamRemoved(const std::vector<int>& seam) {
+	// Only meaningful right after a vertical search produced the table the seam came from
+	if (!incrementalEnabled || pendingRemoval || tableRows != static_cast<int>(seam.size())) {
+		invalidateTable();
+		return;
+	}
+	removed.assign(seam.begin(), seam.end());
+	pendingRemoval = true;
+}
+
+void SeamFinderContext::invalidateTable() {
+	tableRows = tableCols = 0;
+	pendingRemoval = false;
+}
+
+bool SeamFinderContext::canUpdateTable(int rows, int cols, bool forwardEnergy) const {
+	return incrementalEnabled && pendingRemoval && encoding == ParentEncoding::Offset8 &&
+		tableRows == rows && tableCols == cols + 1 && forwardTable == forwardEnergy;
+}
+
+void SeamFinderContext::tableFilled(int rows, int cols, size_t recomputedCells, bool forwardEnergy) {
+	tableRows = rows;
+	tableCols = cols;
+	forwardTable = forwardEnergy;
+	pendingRemoval = false;
+	recomputed = recomputedCells;
+}
+
+size_t SeamFinderContext::parentTableBytes(int rows, int cols) const {
+	if (encoding == ParentEncoding::Offset8)
+		return static_cast<size_t>(rows) * static_cast<size_t>(cols);
+	return std::max(static_cast<size_t>(rows) * packedParentStride(cols), static_cast<size_t>(cols) * packedParentStride(rows));
+}
+
+} // namespace seam
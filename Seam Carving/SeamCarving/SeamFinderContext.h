@@ -0,0 +1,143 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace seam {
+
+// Contiguous buffer from cv::fastMalloc (cache-line aligned) that only goes to the heap when it has to grow
+template <typename T>
+class AlignedBuffer {
+public:
+	AlignedBuffer() = default;
+	~AlignedBuffer() { cv::fastFree(data_); }
+
+	AlignedBuffer(const AlignedBuffer&) = delete;
+	AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+	// Make room for at least count elements, returns true if a new block had to be allocated
+	bool reserve(size_t count) {
+		if (count <= capacity_)
+			return false;
+		cv::fastFree(data_);
+		data_ = static_cast<T*>(cv::fastMalloc(count * sizeof(T)));
+		capacity_ = count;
+		return true;
+	}
+
+	T* data() { return data_; }
+	const T* data() const { return data_; }
+	size_t capacity() const { return capacity_; }
+
+private:
+	T* data_ = nullptr;
+	size_t capacity_ = 0;
+};
+
+// How the DP remembers which neighbour each cell came from. The parent is always -1, 0 or +1 columns
+// away, so one signed byte per cell is enough; Packed2 squeezes four cells into each byte.
+enum class ParentEncoding {
+	Offset8,
+	Packed2
+};
+
+// Work buffers for the DP seam finders. Size it once for the input image and reuse it for every seam:
+// the image only shrinks while carving, so after the first call no further allocations happen.
+class SeamFinderContext {
+public:
+	SeamFinderContext() = default;
+	SeamFinderContext(int rows, int cols, ParentEncoding parentStorage = ParentEncoding::Offset8)
+		: encoding(parentStorage) {
+		reserve(rows, cols);
+	}
+
+	// Grow the buffers (if needed) so a rows x cols energy map fits
+	void reserve(int rows, int cols);
+
+	// Number of heap allocations made by this context so far
+	size_t allocationCount() const { return allocations; }
+
+	ParentEncoding parentEncoding() const { return encoding; }
+	void setParentEncoding(ParentEncoding value) { encoding = value; }
+
+	// Bytes of parent table needed for a rows x cols map with the current encoding
+	size_t parentTableBytes(int rows, int cols) const;
+
+	// Incremental DP for vertical seams (Offset8 only). The cost table is kept between calls; after the
+	// caller reports the removed seam with verticalSeamRemoved(), the next findVerticalSeam recomputes
+	// only the cone below that seam, or everything when the cone would cover more than maxConeFraction
+	// of the table. Horizontal searches share the buffers and simply invalidate the kept table.
+	void setIncremental(bool enabled, double maxConeFraction = 0.5);
+	bool incremental() const { return incrementalEnabled; }
+	void verticalSeamRemoved(const std::vector<int>& seam);
+	void invalidateTable();
+
+	// Full Offset8 fills on all of OpenCV's threads, synchronised every blockRows rows (see
+	// fillCostTableParallel); 0 fills on the calling thread
+	void setParallelFill(int blockRows) { parallelRows = blockRows; }
+	int parallelFillRows() const { return parallelRows; }
+
+	// Threads the parallel fills split into, instead of cv::getNumThreads(); 1 keeps them on the calling
+	// thread, 0 follows OpenCV
+	void setThreads(int count) { threadBudget = count; }
+	int threads() const { return threadBudget; }
+
+	// Full Offset8 fills on one thread in skewed tiles of tileCols x blockRows (see fillCostTableTiled);
+	// tileCols 0 fills row by row
+	void setTiledFill(int tileCols, int blockRows) { tileWidth = tileCols; tileRows = blockRows; }
+	int tiledFillCols() const { return tileWidth; }
+	int tiledFillRows() const { return tileRows; }
+
+	// Bookkeeping used by the finders. A kept table can only be updated by the energy that filled it.
+	bool canUpdateTable(int rows, int cols, bool forwardEnergy = false) const;
+	const std::vector<int>& removedSeam() const { return removed; }
+	double maxConeFraction() const { return coneLimit; }
+	void tableFilled(int rows, int cols, size_t recomputedCells, bool forwardEnergy = false);
+
+	// DP cells written by the last search (rows * cols for a full fill)
+	size_t lastRecomputedCells() const { return recomputed; }
+
+	int* costs() { return cost.data(); }
+	// Offset8: the full parent table. Packed2: a single line that the finders pack after each step.
+	schar* parents() { return parent.data(); }
+	// Packed2 only: 2-bit parent table, packedParentStride() bytes per line
+	uchar* packedParents() { return packed.data(); }
+	std::vector<int>& seam() { return seamBuffer; }
+
+	// Scratch for a line-major (transposed) copy of a horizontal search's energy map, grown on first use
+	uchar* energyLines(size_t cells) {
+		if (lines.reserve(cells))
+			allocations++;
+		return lines.data();
+	}
+
+	// Scratch for the coarse-to-fine search: a size-sized view of the level-th downscaled map, in a buffer
+	// that only grows, and the seam projected up from the level below
+	cv::Mat& pyramidLevel(int level, cv::Size size);
+	cv::Mat& pyramidLevel(int level) { return levels[level]; }
+	std::vector<int>& corridor() { return corridorBuffer; }
+
+private:
+	ParentEncoding encoding = ParentEncoding::Offset8;
+	AlignedBuffer<int> cost;
+	AlignedBuffer<schar> parent;
+	AlignedBuffer<uchar> packed;
+	AlignedBuffer<uchar> lines;
+	std::vector<int> seamBuffer;
+	std::vector<cv::Mat> levelBuffers, levels;
+	std::vector<int> corridorBuffer;
+	size_t allocations = 0;
+
+	bool incrementalEnabled = false;
+	int parallelRows = 0;
+	int threadBudget = 0;
+	int tileWidth = 0, tileRows = 0;
+	double coneLimit = 0.5;
+	int tableRows = 0, tableCols = 0;
+	bool pendingRemoval = false;
+	bool forwardTable = false;
+	std::vector<int> removed;
+	size_t recomputed = 0;
+};
+
+} // namespace seam
@@ -0,0 +1,384 @@
+#include "SeamIndexFile.h"
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+namespace seam {
+
+static const char Magic[8] = { 'S', 'E', 'A', 'M', 'I', 'D', 'X', '\0' };
+static const size_t HeaderBytes = 48;
+
+// Little-endian field access, independent of the host byte order
+template <typename T>
+static T readLE(const uchar* p) {
+	T value = 0;
+	for (size_t b = 0; b < sizeof(T); b++)
+		value |= static_cast<T>(p[b]) << (8 * b);
+	return value;
+}
+
+template <typename T>
+static void putLE(vector<uchar>& out, T value) {
+	for (size_t b = 0; b < sizeof(T); b++)
+		out.push_back(static_cast<uchar>(static_cast<uint64_t>(value) >> (8 * b)));
+}
+
+// 64-bit FNV-1a
+static uint64_t hashBytes(uint64_t hash, const void* bytes, size_t count) {
+	const uchar* p = static_cast<const uchar*>(bytes);
+	for (size_t i = 0; i < count; i++)
+		hash = (hash ^ p[i]) * 0x100000001B3ull;
+	return hash;
+}
+
+template <typename T>
+static uint64_t hashValue(uint64_t hash, T value) {
+	return hashBytes(hash, &value, sizeof(value));
+}
+
+SeamIndexKey seamIndexKey(const Mat& img, const Options& options) {
+	CV_Assert(img.dims == 2);
+	const uint64_t Basis = 0xCBF29CE484222325ull;
+
+	SeamIndexKey key;
+	key.image = hashValue(hashValue(hashValue(Basis, img.cols), img.rows), img.type());
+	for (int i = 0; i < img.rows; i++)
+		key.image = hashBytes(key.image, img.ptr(i), img.cols * img.elemSize());
+
+	// Only what changes which seam goes next: the finder, the energy, the band and the pyramid, each
+	// only while it is on, and the one seam per pass build always carves with. Parent encodings,
+	// incremental DP and the parallel and tiled fills give the same tables, and order and transposes
+	// do not apply to vertical-only carving.
+	const int SeamsPerPass = 1;
+	key.options = Basis;
+	key.options = hashValue(key.options, static_cast<int>(options.algorithm));
+	key.options = hashValue(key.options, static_cast<int>(options.energy));
+	key.options = hashValue(key.options, SeamsPerPass);
+	key.options = hashValue(key.options, options.bandRadius);
+	if (options.bandRadius > 0) {
+		key.options = hashValue(key.options, options.bandExact);
+		if (!options.bandExact)
+			key.options = hashValue(key.options, options.bandCostSlack);
+	}
+	key.options = hashValue(key.options, options.pyramidLevels);
+	if (options.pyramidLevels > 0)
+		key.options = hashValue(key.options, options.pyramidCorridor);
+	return key;
+}
+
+string seamIndexSidecarPath(const string& imagePath) {
+	return imagePath + ".seamidx";
+}
+
+bool writeSeamIndexFile(const string& path, const SeamIndexMap& map, const SeamIndexKey& key, SeamIndexEncoding encoding) {
+	CV_Assert(!map.empty());
+	const Mat& order = map.removalOrder();
+
+	vector<uchar> payload;
+	int entryBytes = 0;
+	if (encoding == SeamIndexEncoding::Raw) {
+		entryBytes = map.seamCount() <= 0xFFFF ? 2 : 4;
+		payload.reserve(order.total() * entryBytes);
+		for (int i = 0; i < order.rows; i++) {
+			const int* row = order.ptr<int>(i);
+			for (int j = 0; j < order.cols; j++) {
+				if (entryBytes == 2)
+					putLE(payload, static_cast<uint16_t>(row[j]));
+				else
+					putLE(payload, static_cast<uint32_t>(row[j]));
+			}
+		}
+	}
+	else {
+		vector<uchar> stream;
+		vector<uint64_t> offsets;
+		for (int i = 0; i < order.rows; i++) {
+			offsets.push_back(stream.size());
+			const int* row = order.ptr<int>(i);
+			int64 previous = 0;
+			for (int j = 0; j < order.cols; j++) {
+				int64 delta = row[j] - previous;
+				previous = row[j];
+				uint64_t zigzag = delta < 0 ? (static_cast<uint64_t>(-delta) << 1) - 1 : static_cast<uint64_t>(delta) << 1;
+				do {
+					uchar byte = zigzag & 0x7F;
+					zigzag >>= 7;
+					stream.push_back(zigzag ? byte | 0x80 : byte);
+				} while (zigzag);
+			}
+		}
+		offsets.push_back(stream.size());
+
+		payload.reserve(offsets.size() * 8 + stream.size());
+		for (uint64_t offset : offsets)
+			putLE(payload, offset);
+		payload.insert(payload.end(), stream.begin(), stream.end());
+	}
+
+	vector<uchar> header(Magic, Magic + sizeof(Magic));
+	putLE(header, SeamIndexFormatVersion);
+	header.push_back(static_cast<uchar>(encoding));
+	header.push_back(static_cast<uchar>(entryBytes));
+	putLE(header, static_cast<uint32_t>(order.cols));
+	putLE(header, static_cast<uint32_t>(order.rows));
+	putLE(header, static_cast<uint32_t>(map.seamCount()));
+	putLE(header, static_cast<uint64_t>(payload.size()));
+	putLE(header, key.image);
+	putLE(header, key.options);
+	CV_Assert(header.size() == HeaderBytes);
+
+	ofstream file(path, ios::binary | ios::trunc);
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+	file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+	return static_cast<bool>(file.flush());
+}
+
+SeamIndexFile::~SeamIndexFile() {
+	close();
+}
+
+bool SeamIndexFile::fail(const string& reason) {
+	close();
+	lastError = reason;
+	return false;
+}
+
+bool SeamIndexFile::open(const string& path) {
+	close();
+	lastError.clear();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return fail("cannot open " + path);
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(HeaderBytes)) {
+		CloseHandle(file);
+		return fail(path + " is not a seam index file");
+	}
+	HANDLE view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!view)
+		return fail("cannot map " + path);
+	const void* mapped = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+	if (!mapped) {
+		CloseHandle(view);
+		return fail("cannot map " + path);
+	}
+	mapping = view;
+	data = static_cast<const uchar*>(mapped);
+	length = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return fail("cannot open " + path);
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(HeaderBytes)) {
+		::close(fd);
+		return fail(path + " is not a seam index file");
+	}
+	void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapped == MAP_FAILED)
+		return fail("cannot map " + path);
+	data = static_cast<const uchar*>(mapped);
+	length = static_cast<size_t>(info.st_size);
+#endif
+
+	if (memcmp(data, Magic, sizeof(Magic)) != 0)
+		return fail(path + " is not a seam index file");
+	uint16_t version = readLE<uint16_t>(data + 8);
+	if (version != SeamIndexFormatVersion)
+		return fail(path + " has unsupported version " + to_string(version));
+
+	uint8_t encodingByte = data[10];
+	entryBytes = data[11];
+	uint32_t fileCols = readLE<uint32_t>(data + 12);
+	uint32_t fileRows = readLE<uint32_t>(data + 16);
+	uint32_t fileSeams = readLE<uint32_t>(data + 20);
+	uint64_t payloadBytes = readLE<uint64_t>(data + 24);
+	builtFrom.image = readLE<uint64_t>(data + 32);
+	builtFrom.options = readLE<uint64_t>(data + 40);
+
+	if (fileCols == 0 || fileRows == 0 || fileCols > INT_MAX || fileRows > INT_MAX || fileSeams >= fileCols)
+		return fail(path + " has an invalid size");
+	if (payloadBytes != length - HeaderBytes)
+		return fail(path + " is truncated");
+	cols = static_cast<int>(fileCols);
+	rows = static_cast<int>(fileRows);
+	seams = static_cast<int>(fileSeams);
+
+	if (encodingByte == static_cast<uint8_t>(SeamIndexEncoding::Raw)) {
+		format = SeamIndexEncoding::Raw;
+		if ((entryBytes != 2 && entryBytes != 4) || (entryBytes == 2 && seams > 0xFFFF))
+			return fail(path + " has an invalid entry size");
+		if (payloadBytes != static_cast<uint64_t>(cols) * rows * entryBytes)
+			return fail(path + " is truncated");
+	}
+	else if (encodingByte == static_cast<uint8_t>(SeamIndexEncoding::DeltaVarint)) {
+		format = SeamIndexEncoding::DeltaVarint;
+		uint64_t tableBytes = (static_cast<uint64_t>(rows) + 1) * 8;
+		if (payloadBytes < tableBytes)
+			return fail(path + " is truncated");
+		// Every row must lie inside the stream, in order
+		uint64_t previous = 0;
+		for (int i = 0; i <= rows; i++) {
+			uint64_t offset = readLE<uint64_t>(payload() + i * 8);
+			if (offset < previous || (i == 0 && offset != 0))
+				return fail(path + " has a corrupt row table");
+			previous = offset;
+		}
+		if (previous != payloadBytes - tableBytes)
+			return fail(path + " has a corrupt row table");
+	}
+	else
+		return fail(path + " has unknown encoding " + to_string(encodingByte));
+
+	return true;
+}
+
+void SeamIndexFile::close() {
+	if (data) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(static_cast<HANDLE>(mapping));
+#else
+		munmap(const_cast<uchar*>(data), length);
+#endif
+	}
+	data = nullptr;
+	mapping = nullptr;
+	length = 0;
+	cols = rows = seams = 0;
+	builtFrom = SeamIndexKey();
+}
+
+// Sequential readers of one row's seam numbers, straight from the mapped payload
+template <typename Entry>
+struct RawRowReader {
+	const uchar* p;
+
+	int operator()() {
+		Entry value = readLE<Entry>(p);
+		p += sizeof(Entry);
+		return static_cast<int>(value);
+	}
+};
+
+struct VarintRowReader {
+	const uchar* p;
+	const uchar* end;
+	int64 previous = 0;
+
+	int operator()() {
+		uint64_t zigzag = 0;
+		for (int shift = 0;; shift += 7) {
+			if (p == end || shift > 35)
+				CV_Error(Error::StsParseError, "corrupt seam index row");
+			uchar byte = *p++;
+			zigzag |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+		int64 delta = (zigzag & 1) ? -static_cast<int64>(zigzag >> 1) - 1 : static_cast<int64>(zigzag >> 1);
+		previous += delta;
+		if (previous < INT_MIN || previous > INT_MAX)
+			CV_Error(Error::StsParseError, "corrupt seam index row");
+		return static_cast<int>(previous);
+	}
+};
+
+// Copy the pixels of one row whose seam number is at least removed, in runs; a row that does not keep
+// exactly width pixels means the file does not belong to this width range
+template <typename Reader>
+static void emitRow(Reader next, const uchar* src, uchar* dst, int cols, int width, int removed, int seams, size_t pixelSize) {
+	int kept = 0;
+	int runStart = -1;
+	for (int j = 0; j <= cols; j++) {
+		bool keep = false;
+		if (j < cols) {
+			int value = next();
+			if (value < 0 || value > seams)
+				CV_Error(Error::StsParseError, "corrupt seam index row");
+			keep = value >= removed;
+		}
+		if (keep && runStart < 0)
+			runStart = j;
+		else if (!keep && runStart >= 0) {
+			int run = j - runStart;
+			if (kept + run > width)
+				CV_Error(Error::StsParseError, "corrupt seam index row");
+			memcpy(dst + kept * pixelSize, src + runStart * pixelSize, run * pixelSize);
+			kept += run;
+			runStart = -1;
+		}
+	}
+	if (kept != width)
+		CV_Error(Error::StsParseError, "corrupt seam index row");
+}
+
+Mat SeamIndexFile::apply(const Mat& img, int width) const {
+	CV_Assert(isOpen() && img.size() == size() && img.dims == 2);
+	CV_Assert(width >= minWidth() && width <= img.cols);
+
+	int removed = img.cols - width;
+	size_t pixelSize = img.elemSize();
+	Mat output(img.rows, width, img.type());
+	for (int i = 0; i < rows; i++) {
+		const uchar* src = img.ptr<uchar>(i);
+		uchar* dst = output.ptr<uchar>(i);
+		if (format == SeamIndexEncoding::Raw) {
+			const uchar* row = payload() + static_cast<size_t>(i) * cols * entryBytes;
+			if (entryBytes == 2)
+				emitRow(RawRowReader<uint16_t>{ row }, src, dst, cols, width, removed, seams, pixelSize);
+			else
+				emitRow(RawRowReader<uint32_t>{ row }, src, dst, cols, width, removed, seams, pixelSize);
+		}
+		else {
+			const uchar* stream = payload() + (static_cast<size_t>(rows) + 1) * 8;
+			VarintRowReader reader{ stream + readLE<uint64_t>(payload() + i * 8), stream + readLE<uint64_t>(payload() + (i + 1) * 8) };
+			emitRow(reader, src, dst, cols, width, removed, seams, pixelSize);
+		}
+	}
+	return output;
+}
+
+SeamIndexMap SeamIndexFile::load() const {
+	CV_Assert(isOpen());
+
+	Mat order(rows, cols, CV_32SC1);
+	const uchar* stream = format == SeamIndexEncoding::DeltaVarint ? payload() + (static_cast<size_t>(rows) + 1) * 8 : nullptr;
+	for (int i = 0; i < rows; i++) {
+		int* row = order.ptr<int>(i);
+		if (format == SeamIndexEncoding::DeltaVarint) {
+			VarintRowReader reader{ stream + readLE<uint64_t>(payload() + i * 8), stream + readLE<uint64_t>(payload() + (i + 1) * 8) };
+			for (int j = 0; j < cols; j++)
+				row[j] = reader();
+		}
+		else {
+			const uchar* raw = payload() + static_cast<size_t>(i) * cols * entryBytes;
+			for (int j = 0; j < cols; j++)
+				row[j] = entryBytes == 2 ? readLE<uint16_t>(raw + j * 2) : static_cast<int>(readLE<uint32_t>(raw + j * 4));
+		}
+		for (int j = 0; j < cols; j++)
+			if (row[j] < 0 || row[j] > seams)
+				CV_Error(Error::StsParseError, "corrupt seam index row");
+	}
+	return SeamIndexMap(order, seams);
+}
+
+} // namespace seam
@@ -0,0 +1,98 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include "SeamIndexMap.h"
+
+namespace seam {
+
+// Sidecar file of a SeamIndexMap (".seamidx"), little-endian:
+//
+//   offset  size  field
+//        0     8  magic "SEAMIDX\0"
+//        8     2  version (SeamIndexFormatVersion)
+//       10     1  encoding (SeamIndexEncoding)
+//       11     1  bytes per entry (2 or 4 for Raw, 0 for DeltaVarint)
+//       12     4  cols
+//       16     4  rows
+//       20     4  seams
+//       24     8  payload bytes, which end the file
+//       32     8  image hash (SeamIndexKey)
+//       40     8  options hash (SeamIndexKey)
+//       48        payload
+//
+// Raw stores the removal-order plane row-major at a fixed entry width, so a mapped file is the plane
+// itself. DeltaVarint stores rows + 1 64-bit offsets into the byte stream that follows them, then every
+// row as zig-zag LEB128 varints of the difference to the previous entry of the row (the first against
+// 0), so each row decodes on its own while emitting pixels.
+enum class SeamIndexEncoding : uint8_t {
+	Raw = 0,
+	DeltaVarint = 1
+};
+
+const uint16_t SeamIndexFormatVersion = 2;
+
+// What a sidecar was built from: a hash of the decoded pixels and one of the options that decide the
+// removal order. A sidecar whose key differs from the image's is stale and has to be rebuilt.
+struct SeamIndexKey {
+	uint64_t image = 0;
+	uint64_t options = 0;
+
+	bool operator==(const SeamIndexKey& other) const { return image == other.image && options == other.options; }
+	bool operator!=(const SeamIndexKey& other) const { return !(*this == other); }
+};
+
+// Key of the removal order SeamIndexMap::build(img, ..., options) produces
+SeamIndexKey seamIndexKey(const cv::Mat& img, const Options& options);
+
+// Path of the sidecar that belongs to an image
+std::string seamIndexSidecarPath(const std::string& imagePath);
+
+// Write map in the sidecar format; false if the file cannot be written
+bool writeSeamIndexFile(const std::string& path, const SeamIndexMap& map, const SeamIndexKey& key, SeamIndexEncoding encoding = SeamIndexEncoding::Raw);
+
+// Read-only memory mapping of a sidecar. Any number of processes can map the same file; apply()
+// reads the mapped entries directly and never materialises the removal-order plane.
+class SeamIndexFile {
+public:
+	SeamIndexFile() = default;
+	~SeamIndexFile();
+	SeamIndexFile(const SeamIndexFile&) = delete;
+	SeamIndexFile& operator=(const SeamIndexFile&) = delete;
+
+	// Map and validate the header and payload layout; false (and the reason in error()) otherwise
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return data != nullptr; }
+	const std::string& error() const { return lastError; }
+
+	SeamIndexEncoding encoding() const { return format; }
+	cv::Size size() const { return cv::Size(cols, rows); }
+	int seamCount() const { return seams; }
+	int minWidth() const { return cols - seams; }
+	const SeamIndexKey& key() const { return builtFrom; }
+	size_t fileSize() const { return length; }
+
+	// Same as SeamIndexMap::apply, straight from the mapped file
+	cv::Mat apply(const cv::Mat& img, int width) const;
+
+	// Decode the whole file into an in-memory map
+	SeamIndexMap load() const;
+
+private:
+	bool fail(const std::string& reason);
+	const uchar* payload() const { return data + 48; }
+
+	const uchar* data = nullptr;
+	size_t length = 0;
+	void* mapping = nullptr;
+
+	SeamIndexEncoding format = SeamIndexEncoding::Raw;
+	int entryBytes = 0;
+	int cols = 0, rows = 0, seams = 0;
+	SeamIndexKey builtFrom;
+	std::string lastError;
+};
+
+} // namespace seam
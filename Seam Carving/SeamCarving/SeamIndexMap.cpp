@@ -0,0 +1,221 @@
+#include "SeamIndexMap.h"
+#include "SeamCarving.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace cv;
+using namespace std;
+
+namespace seam {
+
+SeamIndexMap::SeamIndexMap(const Mat& removalOrder, int recordedSeams) : order(removalOrder), seams(recordedSeams) {
+	CV_Assert(order.type() == CV_32SC1 && seams >= 0 && seams < order.cols);
+}
+
+SeamIndexMap SeamIndexMap::build(const Mat& img, int minWidth, const Options& options) {
+	CV_Assert(!img.empty() && minWidth >= 1 && minWidth <= img.cols);
+
+	SeamIndexMap map;
+	map.seams = img.cols - minWidth;
+	map.order.create(img.size(), CV_32SC1);
+	map.order.setTo(map.seams);
+
+	// Original column of every pixel still in the image, carved in lockstep with it
+	Mat columns(img.size(), CV_32SC1);
+	for (int i = 0; i < columns.rows; i++) {
+		int* row = columns.ptr<int>(i);
+		for (int j = 0; j < columns.cols; j++)
+			row[j] = j;
+	}
+
+	int removed = 0;
+	SeamCarver carver;
+	carver.setSeamCallback([&](const Mat&, const vector<int>& seam, SeamDirection) {
+		for (int i = 0; i < columns.rows; i++)
+			map.order.at<int>(i, columns.ptr<int>(i)[seam[i]]) = removed;
+		removeVerticalSeamInPlace(columns, seam, options.threads);
+		removed++;
+	});
+	// A batch reports its seams left to right, not in the order they were found, so the numbering
+	// needs them one at a time
+	Options single = options;
+	single.seamsPerPass = 1;
+	carver.retarget(img, Size(minWidth, img.rows), single);
+	CV_Assert(removed == map.seams);
+
+	// Builds inside a larger job (retargetViaProxy) count towards its profile
+	if (Profile* outer = activeProfile())
+		outer->merge(carver.profile());
+	return map;
+}
+
+Mat SeamIndexMap::apply(const Mat& img, int width) const {
+	CV_Assert(img.size() == order.size() && img.dims == 2);
+	CV_Assert(width >= minWidth() && width <= img.cols);
+
+	// Keep what the first cols - width seams did not remove, copying runs of kept pixels at once
+	int removed = img.cols - width;
+	size_t pixelSize = img.elemSize();
+	Mat output(img.rows, width, img.type());
+	for (int i = 0; i < img.rows; i++) {
+		const int* seamOf = order.ptr<int>(i);
+		const uchar* src = img.ptr<uchar>(i);
+		uchar* dst = output.ptr<uchar>(i);
+		for (int j = 0; j < img.cols;) {
+			if (seamOf[j] < removed) {
+				j++;
+				continue;
+			}
+			int start = j;
+			while (j < img.cols && seamOf[j] >= removed)
+				j++;
+			memcpy(dst, src + start * pixelSize, (j - start) * pixelSize);
+			dst += (j - start) * pixelSize;
+		}
+	}
+	return output;
+}
+
+// Map row whose centre is nearest to that of line i of count full-resolution lines
+static int nearestMapRow(int i, int count, int mapRows) {
+	return min(static_cast<int>((2 * static_cast<int64_t>(i) + 1) * mapRows / (2 * count)), mapRows - 1);
+}
+
+// Which of the pixels of one full-resolution line a map row keeps when removed of them go: map column p
+// covers pixels [edge[p], edge[p + 1]), the blocks of the lowest seam numbers go first, and widths below
+// what the seams cover eat into the blocks the map kept, left to right
+static void scaledKeepMask(const int* seamOf, int mapCols, int seams, const vector<int>& edge, int removed, vector<int>& columnOf, vector<uchar>& keep) {
+	for (int p = 0; p < mapCols; p++)
+		if (seamOf[p] < seams)
+			columnOf[seamOf[p]] = p;
+
+	fill(keep.begin(), keep.end(), 1);
+	int left = removed;
+	auto cut = [&](int p) {
+		int block = edge[p + 1] - edge[p];
+		int take = min(block, left);
+		int start = edge[p] + (block - take) / 2;
+		fill(keep.begin() + start, keep.begin() + start + take, 0);
+		left -= take;
+	};
+	for (int k = 0; k < seams && left > 0; k++)
+		cut(columnOf[k]);
+	for (int p = 0; p < mapCols && left > 0; p++)
+		if (seamOf[p] == seams)
+			cut(p);
+}
+
+static vector<int> scaledEdges(int mapCols, int length) {
+	vector<int> edge(mapCols + 1);
+	for (int p = 0; p <= mapCols; p++)
+		edge[p] = static_cast<int>(static_cast<int64_t>(p) * length / mapCols);
+	return edge;
+}
+
+Mat SeamIndexMap::applyScaled(const Mat& img, int width) const {
+	CV_Assert(!empty() && img.dims == 2 && img.cols >= order.cols && img.rows >= order.rows);
+	CV_Assert(width >= 1 && width <= img.cols);
+
+	vector<int> edge = scaledEdges(order.cols, img.cols);
+	int removed = img.cols - width;
+	size_t pixelSize = img.elemSize();
+	Mat output(img.rows, width, img.type());
+	vector<int> columnOf(seams);
+	vector<uchar> keep(img.cols);
+	for (int i = 0; i < img.rows; i++) {
+		scaledKeepMask(order.ptr<int>(nearestMapRow(i, img.rows, order.rows)), order.cols, seams, edge, removed, columnOf, keep);
+
+		const uchar* src = img.ptr<uchar>(i);
+		uchar* dst = output.ptr<uchar>(i);
+		for (int j = 0; j < img.cols;) {
+			if (!keep[j]) {
+				j++;
+				continue;
+			}
+			int start = j;
+			while (j < img.cols && keep[j])
+				j++;
+			memcpy(dst, src + start * pixelSize, (j - start) * pixelSize);
+			dst += (j - start) * pixelSize;
+		}
+	}
+	return output;
+}
+
+Mat SeamIndexMap::applyScaledRows(const Mat& img, int height) const {
+	CV_Assert(!empty() && img.dims == 2 && img.rows >= order.cols && img.cols >= order.rows);
+	CV_Assert(height >= 1 && height <= img.rows);
+
+	// The img rows every map row keeps; map row m stands for the img columns nearest to it
+	vector<int> edge = scaledEdges(order.cols, img.rows);
+	Mat kept(order.rows, height, CV_32SC1);
+	vector<int> columnOf(seams);
+	vector<uchar> keep(img.rows);
+	for (int m = 0; m < order.rows; m++) {
+		scaledKeepMask(order.ptr<int>(m), order.cols, seams, edge, img.rows - height, columnOf, keep);
+		int* rows = kept.ptr<int>(m);
+		for (int i = 0; i < img.rows; i++)
+			if (keep[i])
+				*rows++ = i;
+	}
+
+	vector<int> mapRowOf(img.cols);
+	for (int j = 0; j < img.cols; j++)
+		mapRowOf[j] = nearestMapRow(j, img.cols, order.rows);
+
+	// Output row r is img row kept(m, r) across the columns of map row m, copied in runs that share it
+	size_t pixelSize = img.elemSize();
+	Mat output(height, img.cols, img.type());
+	for (int r = 0; r < height; r++) {
+		uchar* dst = output.ptr<uchar>(r);
+		for (int j = 0; j < img.cols;) {
+			int source = kept.at<int>(mapRowOf[j], r);
+			int start = j;
+			while (j < img.cols && kept.at<int>(mapRowOf[j], r) == source)
+				j++;
+			memcpy(dst + start * pixelSize, img.ptr<uchar>(source) + start * pixelSize, (j - start) * pixelSize);
+		}
+	}
+	return output;
+}
+
+// Seams the proxy needs so that applyScaled can remove `removed` of `cols` full-resolution columns: every
+// proxy column covers at least cols / proxyCols of them
+static int proxySeams(int removed, int cols, int proxyCols) {
+	int narrowest = cols / proxyCols;
+	return min((removed + narrowest - 1) / narrowest, proxyCols - 1);
+}
+
+Mat retargetViaProxy(const Mat& img, Size target, double proxyScale, const Options& options) {
+	CV_Assert(!img.empty() && proxyScale > 0 && proxyScale <= 1);
+	CV_Assert(target.width > 0 && target.height > 0 && target.width <= img.cols && target.height <= img.rows);
+
+	Mat proxy;
+	Size proxySize(max(cvRound(img.cols * proxyScale), 2), max(cvRound(img.rows * proxyScale), 2));
+	resize(img, proxy, proxySize, 0, 0, INTER_AREA);
+
+	Mat output = img;
+	if (target.width < img.cols) {
+		int seams = proxySeams(img.cols - target.width, img.cols, proxy.cols);
+		SeamIndexMap widthMap = SeamIndexMap::build(proxy, proxy.cols - seams, options);
+		SEAM_PROFILE_PHASE(Removal);
+		output = widthMap.applyScaled(img, target.width);
+		proxy = widthMap.apply(proxy, proxy.cols - seams);
+	}
+	if (target.height < img.rows) {
+		// Only the proxy is transposed, the full-resolution rows are cut in place
+		Mat proxyRows;
+		{
+			SEAM_PROFILE_PHASE(Transpose);
+			transpose(proxy, proxyRows);
+		}
+		int seams = proxySeams(img.rows - target.height, img.rows, proxyRows.cols);
+		SeamIndexMap heightMap = SeamIndexMap::build(proxyRows, proxyRows.cols - seams, options);
+		SEAM_PROFILE_PHASE(Removal);
+		output = heightMap.applyScaledRows(output, target.height);
+	}
+	return output.data == img.data ? img.clone() : output;
+}
+
+} // namespace seam
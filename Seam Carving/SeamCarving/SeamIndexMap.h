@@ -0,0 +1,56 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include "SeamCarver.h"
+
+namespace seam {
+
+// Precomputed vertical seam order of one image (the "index map" of Avidan & Shamir). The image is
+// carved down once; every pixel then records the number of the seam that removed it, counting from 0,
+// and pixels that were never removed record seamCount(). The image at any width w between minWidth()
+// and the original width is then just the pixels whose number is at least cols - w, in one pass. It
+// equals what SeamCarver::retarget produces for that width with seamsPerPass = 1 and otherwise the
+// same options; with several seams per pass retarget removes different seams.
+class SeamIndexMap {
+public:
+	SeamIndexMap() = default;
+
+	// Carve img down to minWidth (vertical seams only, one per pass whatever seamsPerPass says) and
+	// record the removal order. The carving profile is merged into the active profile, if any.
+	static SeamIndexMap build(const cv::Mat& img, int minWidth, const Options& options = Options());
+
+	// img (or any plane aligned with it, of any type) at the given width
+	cv::Mat apply(const cv::Mat& img, int width) const;
+
+	// The same for a larger version of the image the map was built on (the full-resolution original of
+	// a downscaled proxy). Every map pixel stands for the block of img pixels it was scaled from; each row
+	// loses the blocks of the lowest seam numbers, and of the last block only the pixels around its
+	// centre that are still needed. img is read once.
+	cv::Mat applyScaled(const cv::Mat& img, int width) const;
+
+	// applyScaled along the other axis, for a map built on the transposed proxy: img at the given height,
+	// cut row-wise without transposing img
+	cv::Mat applyScaledRows(const cv::Mat& img, int height) const;
+
+	bool empty() const { return order.empty(); }
+	cv::Size size() const { return order.size(); }
+	int seamCount() const { return seams; }
+	int minWidth() const { return order.cols - seams; }
+
+	// CV_32SC1, one seam number per pixel of the original image
+	const cv::Mat& removalOrder() const { return order; }
+
+	// Adopt an order map made elsewhere (e.g. loaded from disk) that holds recordedSeams seams
+	SeamIndexMap(const cv::Mat& removalOrder, int recordedSeams);
+
+private:
+	cv::Mat order;
+	int seams = 0;
+};
+
+// Low-precision retargeting for thumbnails and previews: plan every seam on a copy of img downscaled by
+// proxyScale (0 < proxyScale <= 1) and cut the full-resolution pixels with applyScaled, one pass per
+// dimension that shrinks (a shrinking height plans on the transposed proxy and cuts with
+// applyScaledRows). Timings and counters go to the active profile, if any.
+cv::Mat retargetViaProxy(const cv::Mat& img, cv::Size target, double proxyScale, const Options& options = Options());
+
+} // namespace seam
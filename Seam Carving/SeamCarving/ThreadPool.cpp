@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace seam {
+
+// The pool is kept next to the index: a task of one pool may submit to another
+static thread_local const ThreadPool* workerPool = nullptr;
+static thread_local int workerIndex = -1;
+
+ThreadPool::ThreadPool(int threads) {
+	if (threads <= 0)
+		threads = max(1u, thread::hardware_concurrency());
+
+	for (int i = 0; i < threads; i++)
+		queues.push_back(make_unique<Queue>());
+	for (int i = 0; i < threads; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	wait();
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (thread& worker : workers)
+		worker.join();
+}
+
+int ThreadPool::currentWorker() const {
+	return workerPool == this ? workerIndex : -1;
+}
+
+void ThreadPool::submit(Task task) {
+	pending++;
+
+	int index = currentWorker();
+	if (index < 0)
+		index = static_cast<int>(nextQueue++ % queues.size());
+	{
+		lock_guard<mutex> lock(queues[index]->mutex);
+		queues[index]->tasks.push_back(move(task));
+	}
+
+	// Counted under sleepMutex so a worker about to sleep cannot miss it
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		queued++;
+	}
+	wake.notify_one();
+}
+
+void ThreadPool::wait() {
+	unique_lock<mutex> lock(sleepMutex);
+	idle.wait(lock, [this] { return pending.load() == 0; });
+}
+
+// Own deque newest first, then the other deques oldest first, starting with the next worker
+bool ThreadPool::takeTask(int index, Task& task) {
+	{
+		Queue& own = *queues[index];
+		lock_guard<mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	int count = static_cast<int>(queues.size());
+	for (int k = 1; k < count; k++) {
+		Queue& victim = *queues[(index + k) % count];
+		lock_guard<mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = move(victim.tasks.front());
+			victim.tasks.pop_front();
+			steals++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(int index) {
+	workerPool = this;
+	workerIndex = index;
+
+	while (true) {
+		Task task;
+		if (takeTask(index, task)) {
+			queued--;
+			task();
+			task = nullptr;
+
+			if (--pending == 0) {
+				lock_guard<mutex> lock(sleepMutex);
+				idle.notify_all();
+			}
+			continue;
+		}
+
+		unique_lock<mutex> lock(sleepMutex);
+		wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+		if (stopping && queued.load() == 0)
+			return;
+	}
+}
+
+} // namespace seam
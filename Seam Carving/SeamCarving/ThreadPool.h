@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace seam {
+
+// Fixed set of worker threads that live as long as the pool. Every worker owns a task deque: tasks
+// submitted from inside a worker go to the back of its own deque and are taken newest first (their
+// data is still in that core's cache), while idle workers steal the oldest task from another deque.
+// Tasks submitted from outside the pool are spread round-robin. Tasks must not throw.
+class ThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+	// threads <= 0 uses one worker per hardware thread
+	explicit ThreadPool(int threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void submit(Task task);
+
+	// Block until every submitted task, including the ones submitted by tasks, has finished
+	void wait();
+
+	int size() const { return static_cast<int>(workers.size()); }
+
+	// Index of the calling worker thread within this pool, -1 when not called from one of its workers
+	int currentWorker() const;
+
+	// Tasks run by a worker other than the one whose deque they were queued on
+	uint64_t stolenTasks() const { return steals.load(); }
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void workerLoop(int index);
+	bool takeTask(int index, Task& task);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	// Sleeping workers wait on wake until something is queued, wait() on idle until nothing is pending
+	std::mutex sleepMutex;
+	std::condition_variable wake, idle;
+	std::atomic<int> queued{ 0 };	// sitting in a deque
+	std::atomic<int> pending{ 0 };	// submitted and not finished yet
+	std::atomic<unsigned> nextQueue{ 0 };
+	std::atomic<uint64_t> steals{ 0 };
+	bool stopping = false;
+};
+
+} // namespace seam
@@ -1,14 +1,513 @@
+#include "BatchProcessor.h"
+#include "SeamCarver.h"
 #include "SeamCarving.h"
+#include "SeamIndexFile.h"
+#include "SeamIndexMap.h"
+#include "Benchmark.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <opencv2/imgcodecs.hpp>
+#ifndef SEAM_CARVING_NO_GUI
+#include <opencv2/highgui.hpp>
+#endif
+#include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
 
 using namespace cv;
 using namespace std;
+using namespace seam;
 
 #define GREEDY 'G'
 #define DYNAMIC 'D'
 
-int main() {
-	std::string filename = "../SeamCarving/Assets/pietro.jpg";
+struct CommandLine {
+    vector<string> inputs;
+    string batch;
+    string statsJson;
+    vector<int> widths;
+    int indexMinWidth = 0;
+    bool varintIndex = false;
+    double proxyScale = 1;
+    string output;
+    Size target;
+    Options options;
+    int threads = 0;
+    int grain = -1;
+};
+
+static void printUsage() {
+    cout << "Usage:" << endl
+        << "  SeamCarving                                   interactive mode on Assets/pietro.jpg" << endl
+        << "  SeamCarving -s WxH [options] input...         headless batch mode" << endl
+        << "  SeamCarving -s WxH [options] --batch PATH     batch mode on a thread pool; PATH is a" << endl
+        << "                                                directory of images or a manifest file" << endl
+        << "  SeamCarving --widths W1,W2,... [options] input...  carve once, write every width" << endl
+        << "  SeamCarving --make-index W [options] input... write <input>.seamidx down to width W" << endl
+        << "  SeamCarving --bench [name [args...]]          kernel benchmarks" << endl
+        << endl
+        << "Options:" << endl
+        << "  -s, --size WxH          target size in pixels (required)" << endl
+        << "  -o, --output PATH       output file for one input, output directory for several" << endl
+        << "                          (default: output.jpg, or <name>_carved.<ext> per input)" << endl
+        << "  -a, --algorithm NAME    dp (default) or greedy" << endl
+        << "  -e, --energy NAME       backward (default, Sobel) or forward (DP only)" << endl
+        << "      --widths LIST       comma-separated widths; the image is carved once to the smallest" << endl
+        << "                          and every width is cut from the seam index map (-s not needed);" << endl
+        << "                          an <input>.seamidx sidecar that covers the widths is used as is" << endl
+        << "      --make-index W      write a seam index sidecar per input, usable down to width W" << endl
+        << "      --varint            delta/varint-compress the sidecar instead of storing it raw" << endl
+        << "      --proxy S           plan the seams on a copy scaled by S (0 < S < 1) and cut the" << endl
+        << "                          full-resolution image from them; faster, less precise" << endl
+        << "  -k, --seams-per-pass N  seams taken from each DP table in runs (default 1, exact);" << endl
+        << "                          larger is faster at some cost in seam quality" << endl
+        << "      --band R            search each vertical seam within R columns of the previous one" << endl
+        << "                          first, with the full DP as fallback unless the band seam is" << endl
+        << "                          provably the cheapest (default 0 = off)" << endl
+        << "      --band-approx       keep band seams on cheap heuristics instead of the proof;" << endl
+        << "                          faster, not always the cheapest seam" << endl
+        << "      --pyramid N         find vertical seams coarse-to-fine over up to N halvings of the" << endl
+        << "                          energy map (default 0 = exact DP)" << endl
+        << "      --corridor W        columns either side searched per pyramid level (default 4)" << endl
+        << "      --dp-block R        rows between thread syncs of the parallel DP fill (default 32," << endl
+        << "                          0 = single-threaded fill)" << endl
+        << "      --dp-tile C         single-threaded DP fill in skewed tiles C columns wide" << endl
+        << "                          (default 0 = row by row)" << endl
+        << "      --order NAME        interleaved (default), vertical-first or horizontal-first" << endl
+        << "  -t, --threads N         threads OpenCV may use (0 = OpenCV default); worker" << endl
+        << "                          threads in batch mode (0 = one per hardware thread)" << endl
+        << "      --grain N           pixels per thread task in seam removal" << endl
+        << "                          (default 65536, 0 = single-threaded)" << endl
+        << "      --batch PATH        directory, or manifest with one 'input[<TAB>output]' per line" << endl
+        << "      --verify-energy     check the incremental energy map after every seam" << endl
+        << "      --stats-json PATH   write per-image phase timings and counters as JSON" << endl
+        << "                          (timers need a build with SEAM_ENABLE_PROFILING=1)" << endl
+        << "  -h, --help              show this help" << endl;
+}
+
+static bool parseSize(const string& text, Size& size) {
+    int width = 0, height = 0;
+    char separator = 0, trailing = 0;
+    if (sscanf(text.c_str(), "%d%c%d%c", &width, &separator, &height, &trailing) != 3)
+        return false;
+    if ((separator != 'x' && separator != 'X') || width <= 0 || height <= 0)
+        return false;
+    size = Size(width, height);
+    return true;
+}
+
+// Returns false (after printing why) when the arguments are unusable
+static bool parseCommandLine(int argc, char** argv, CommandLine& cmd) {
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        bool hasValue = a + 1 < argc;
+
+        if (arg == "-h" || arg == "--help") {
+            printUsage();
+            exit(0);
+        }
+        else if ((arg == "-s" || arg == "--size") && hasValue) {
+            if (!parseSize(argv[++a], cmd.target)) {
+                cerr << "Invalid size '" << argv[a] << "', expected WxH" << endl;
+                return false;
+            }
+        }
+        else if ((arg == "-o" || arg == "--output") && hasValue) {
+            cmd.output = argv[++a];
+        }
+        else if ((arg == "-a" || arg == "--algorithm") && hasValue) {
+            string name = argv[++a];
+            if (name == "dp" || name == "d")
+                cmd.options.algorithm = SeamAlgorithm::DynamicProgramming;
+            else if (name == "greedy" || name == "g")
+                cmd.options.algorithm = SeamAlgorithm::Greedy;
+            else {
+                cerr << "Unknown algorithm '" << name << "', expected dp or greedy" << endl;
+                return false;
+            }
+        }
+        else if ((arg == "-e" || arg == "--energy") && hasValue) {
+            string name = argv[++a];
+            if (name == "backward")
+                cmd.options.energy = SeamEnergy::Backward;
+            else if (name == "forward")
+                cmd.options.energy = SeamEnergy::Forward;
+            else {
+                cerr << "Unknown energy '" << name << "', expected backward or forward" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--proxy" && hasValue) {
+            cmd.proxyScale = atof(argv[++a]);
+            if (cmd.proxyScale <= 0 || cmd.proxyScale >= 1) {
+                cerr << "Invalid proxy scale '" << argv[a] << "', expected 0 < S < 1" << endl;
+                return false;
+            }
+        }
+        else if ((arg == "-k" || arg == "--seams-per-pass") && hasValue) {
+            cmd.options.seamsPerPass = atoi(argv[++a]);
+            if (cmd.options.seamsPerPass < 1) {
+                cerr << "Invalid seams per pass '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--band" && hasValue) {
+            cmd.options.bandRadius = atoi(argv[++a]);
+            if (cmd.options.bandRadius < 0) {
+                cerr << "Invalid band radius '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--band-approx") {
+            cmd.options.bandExact = false;
+        }
+        else if (arg == "--pyramid" && hasValue) {
+            cmd.options.pyramidLevels = atoi(argv[++a]);
+            if (cmd.options.pyramidLevels < 0) {
+                cerr << "Invalid pyramid depth '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--corridor" && hasValue) {
+            cmd.options.pyramidCorridor = atoi(argv[++a]);
+            if (cmd.options.pyramidCorridor < 1) {
+                cerr << "Invalid corridor width '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--dp-block" && hasValue) {
+            cmd.options.parallelDPRows = atoi(argv[++a]);
+            if (cmd.options.parallelDPRows < 0) {
+                cerr << "Invalid DP block '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--dp-tile" && hasValue) {
+            cmd.options.dpTileCols = atoi(argv[++a]);
+            if (cmd.options.dpTileCols < 0) {
+                cerr << "Invalid DP tile width '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--order" && hasValue) {
+            string name = argv[++a];
+            if (name == "interleaved")
+                cmd.options.order = CarveOrder::Interleaved;
+            else if (name == "vertical-first")
+                cmd.options.order = CarveOrder::VerticalFirst;
+            else if (name == "horizontal-first")
+                cmd.options.order = CarveOrder::HorizontalFirst;
+            else {
+                cerr << "Unknown order '" << name << "', expected interleaved, vertical-first or horizontal-first" << endl;
+                return false;
+            }
+        }
+        else if ((arg == "-t" || arg == "--threads") && hasValue) {
+            cmd.threads = atoi(argv[++a]);
+        }
+        else if (arg == "--grain" && hasValue) {
+            cmd.grain = atoi(argv[++a]);
+            if (cmd.grain < 0) {
+                cerr << "Invalid grain '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--batch" && hasValue) {
+            cmd.batch = argv[++a];
+        }
+        else if (arg == "--widths" && hasValue) {
+            string list = argv[++a];
+            for (size_t pos = 0; pos <= list.size();) {
+                size_t comma = min(list.find(',', pos), list.size());
+                int width = atoi(list.substr(pos, comma - pos).c_str());
+                if (width <= 0) {
+                    cerr << "Invalid width list '" << list << "'" << endl;
+                    return false;
+                }
+                cmd.widths.push_back(width);
+                pos = comma + 1;
+            }
+        }
+        else if (arg == "--make-index" && hasValue) {
+            cmd.indexMinWidth = atoi(argv[++a]);
+            if (cmd.indexMinWidth <= 0) {
+                cerr << "Invalid index width '" << argv[a] << "'" << endl;
+                return false;
+            }
+        }
+        else if (arg == "--varint") {
+            cmd.varintIndex = true;
+        }
+        else if (arg == "--stats-json" && hasValue) {
+            cmd.statsJson = argv[++a];
+        }
+        else if (arg == "--verify-energy") {
+            cmd.options.verifyEnergy = true;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            cerr << "Unknown or incomplete option '" << arg << "'" << endl;
+            return false;
+        }
+        else {
+            cmd.inputs.push_back(arg);
+        }
+    }
+
+    if (cmd.proxyScale < 1 && (!cmd.batch.empty() || !cmd.widths.empty() || cmd.indexMinWidth > 0)) {
+        cerr << "--proxy only applies to input images carved to -s WxH" << endl;
+        return false;
+    }
+    if (!cmd.widths.empty() || cmd.indexMinWidth > 0) {
+        if (cmd.inputs.empty() || !cmd.batch.empty()) {
+            cerr << "--widths and --make-index need at least one input image (and no --batch)" << endl;
+            return false;
+        }
+        return true;
+    }
+    if ((cmd.inputs.empty() && cmd.batch.empty()) || cmd.target.area() == 0) {
+        cerr << "Need a target size (-s WxH) and at least one input image or --batch" << endl;
+        return false;
+    }
+    if (!cmd.inputs.empty() && !cmd.batch.empty()) {
+        cerr << "Give either input images or --batch, not both" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Where the carved version of input goes
+static string outputPathFor(const CommandLine& cmd, const string& input) {
+    size_t slash = input.find_last_of("/\\");
+    string name = slash == string::npos ? input : input.substr(slash + 1);
+
+    if (cmd.inputs.size() == 1)
+        return cmd.output.empty() ? "output.jpg" : cmd.output;
+    if (!cmd.output.empty())
+        return cmd.output + "/" + name;
+
+    size_t dot = name.find_last_of('.');
+    if (dot == string::npos)
+        return name + "_carved.png";
+    return name.substr(0, dot) + "_carved" + name.substr(dot);
+}
+
+static string jsonString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// {"jobs":[{"input":..,"profile":{..}},..],"total":{..}}
+static bool writeStatsJSON(const string& path, const vector<string>& inputs, const vector<Profile>& profiles) {
+    ofstream out(path);
+    Profile total;
+    out << "{\"jobs\":[";
+    for (size_t i = 0; i < profiles.size(); i++) {
+        out << (i ? ",\n" : "\n") << "{\"input\":" << jsonString(inputs[i]) << ",\"profile\":" << profiles[i].toJSON() << "}";
+        total.merge(profiles[i]);
+    }
+    out << "\n],\"total\":" << total.toJSON() << "}" << endl;
+    if (!out) {
+        cerr << "Cannot write " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+static int runHeadless(const CommandLine& cmd) {
+    if (cmd.threads > 0)
+        setNumThreads(cmd.threads);
+
+    // One carver for the whole run so its work buffers are reused from image to image
+    SeamCarver carver;
+    int failures = 0;
+    vector<string> carvedInputs;
+    vector<Profile> profiles;
+    for (const string& input : cmd.inputs) {
+        // Keep alpha, 16-bit and gray images as they are, they are carved natively
+        Mat img = imread(input, IMREAD_UNCHANGED);
+        if (img.empty()) {
+            cerr << input << ": cannot read image" << endl;
+            failures++;
+            continue;
+        }
+        if (cmd.target.width > img.cols || cmd.target.height > img.rows) {
+            cerr << input << ": target " << cmd.target.width << "x" << cmd.target.height
+                << " exceeds the image size " << img.cols << "x" << img.rows << endl;
+            failures++;
+            continue;
+        }
+
+        int64 start = getTickCount();
+        bool proxy = cmd.proxyScale < 1;
+        Profile proxyProfile;
+        Mat carved;
+        if (proxy) {
+            ProfileScope scope(proxyProfile);
+            carved = retargetViaProxy(img, cmd.target, cmd.proxyScale, cmd.options);
+        }
+        else
+            carved = carver.retarget(img, cmd.target, cmd.options);
+        double seconds = (getTickCount() - start) / getTickFrequency();
+        carvedInputs.push_back(input);
+        profiles.push_back(proxy ? proxyProfile : carver.profile());
+        if (cmd.options.verifyEnergy && !proxy)
+            cout << input << ": incremental energy mismatches against full recompute: " << carver.energyMismatches() << endl;
+
+        string output = outputPathFor(cmd, input);
+        if (!imwrite(output, carved)) {
+            cerr << input << ": cannot write " << output << endl;
+            failures++;
+            continue;
+        }
+        cout << input << " (" << img.cols << "x" << img.rows << ") -> " << output
+            << " (" << carved.cols << "x" << carved.rows << ") in " << seconds * 1e3 << " ms" << endl;
+    }
+
+    if (!cmd.statsJson.empty() && !writeStatsJSON(cmd.statsJson, carvedInputs, profiles))
+        failures++;
+    return failures == 0 ? 0 : 1;
+}
+
+// Output path of one width: the usual output path with _w<width> before the extension
+static string widthOutputPath(const CommandLine& cmd, const string& input, int width) {
+    string path = outputPathFor(cmd, input);
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        dot = path.size();
+    return path.substr(0, dot) + "_w" + to_string(width) + path.substr(dot);
+}
+
+static int runWidths(const CommandLine& cmd) {
+    if (cmd.threads > 0)
+        setNumThreads(cmd.threads);
+
+    int minWidth = *min_element(cmd.widths.begin(), cmd.widths.end());
+    int failures = 0;
+    for (const string& input : cmd.inputs) {
+        Mat img = imread(input, IMREAD_UNCHANGED);
+        if (img.empty() || minWidth > img.cols) {
+            cerr << input << (img.empty() ? ": cannot read image" : ": width exceeds the image width") << endl;
+            failures++;
+            continue;
+        }
+
+        // A sidecar made earlier saves carving altogether, if it was built from these pixels with these
+        // options and reaches far enough
+        int64 start = getTickCount();
+        SeamIndexFile sidecar;
+        SeamIndexMap map;
+        if (sidecar.open(seamIndexSidecarPath(input)) && sidecar.size() == img.size() && sidecar.minWidth() <= minWidth
+            && sidecar.key() == seamIndexKey(img, cmd.options)) {
+            cout << input << " (" << img.cols << "x" << img.rows << "): mapped " << seamIndexSidecarPath(input) << endl;
+        }
+        else {
+            sidecar.close();
+            map = SeamIndexMap::build(img, minWidth, cmd.options);
+            double buildSeconds = (getTickCount() - start) / getTickFrequency();
+            cout << input << " (" << img.cols << "x" << img.rows << "): " << map.seamCount() << " seams in "
+                << buildSeconds * 1e3 << " ms" << endl;
+        }
+
+        for (int width : cmd.widths) {
+            if (width > img.cols) {
+                cerr << input << ": width " << width << " exceeds the image width" << endl;
+                failures++;
+                continue;
+            }
+            start = getTickCount();
+            Mat carved = sidecar.isOpen() ? sidecar.apply(img, width) : map.apply(img, width);
+            double applySeconds = (getTickCount() - start) / getTickFrequency();
+
+            string output = widthOutputPath(cmd, input, width);
+            if (!imwrite(output, carved)) {
+                cerr << input << ": cannot write " << output << endl;
+                failures++;
+                continue;
+            }
+            cout << "  -> " << output << " in " << applySeconds * 1e3 << " ms" << endl;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+static int runMakeIndex(const CommandLine& cmd) {
+    if (cmd.threads > 0)
+        setNumThreads(cmd.threads);
+
+    SeamIndexEncoding encoding = cmd.varintIndex ? SeamIndexEncoding::DeltaVarint : SeamIndexEncoding::Raw;
+    int failures = 0;
+    for (const string& input : cmd.inputs) {
+        Mat img = imread(input, IMREAD_UNCHANGED);
+        if (img.empty() || cmd.indexMinWidth > img.cols) {
+            cerr << input << (img.empty() ? ": cannot read image" : ": index width exceeds the image width") << endl;
+            failures++;
+            continue;
+        }
+
+        int64 start = getTickCount();
+        SeamIndexMap map = SeamIndexMap::build(img, cmd.indexMinWidth, cmd.options);
+        string sidecar = seamIndexSidecarPath(input);
+        SeamIndexFile written;
+        if (!writeSeamIndexFile(sidecar, map, seamIndexKey(img, cmd.options), encoding) || !written.open(sidecar)) {
+            cerr << input << ": cannot write " << sidecar << endl;
+            failures++;
+            continue;
+        }
+        double seconds = (getTickCount() - start) / getTickFrequency();
+        cout << input << " -> " << sidecar << " (" << map.seamCount() << " seams, "
+            << written.fileSize() / 1024 << " KiB) in " << seconds * 1e3 << " ms" << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+static int runBatch(const CommandLine& cmd) {
+    vector<BatchItem> items;
+    if (utils::fs::isDirectory(cmd.batch))
+        items = listBatchDirectory(cmd.batch, cmd.output);
+    else if (!readBatchManifest(cmd.batch, cmd.output, items)) {
+        cerr << cmd.batch << ": cannot read batch manifest" << endl;
+        return 1;
+    }
+    if (items.empty()) {
+        cerr << cmd.batch << ": no images to process" << endl;
+        return 1;
+    }
+
+    BatchProcessor processor(cmd.threads);
+    cout << "Carving " << items.size() << " images to " << cmd.target.width << "x" << cmd.target.height
+        << " on " << processor.threads() << " threads" << endl;
+    BatchStats stats = processor.run(items, cmd.target, cmd.options);
+
+    for (const string& error : stats.errors)
+        cerr << error << endl;
+    cout << stats.succeeded << " images in " << stats.seconds << " s, " << stats.imagesPerSecond << " images/s" << endl
+        << "latency p50 " << stats.p50Ms << " ms, p99 " << stats.p99Ms << " ms, max " << stats.maxMs << " ms" << endl
+        << stats.failed << " failed, " << stats.stolenTasks << " tasks stolen" << endl;
+
+    if (!cmd.statsJson.empty()) {
+        vector<string> inputs;
+        for (const BatchItem& item : items)
+            inputs.push_back(item.input);
+        if (!writeStatsJSON(cmd.statsJson, inputs, stats.jobProfiles))
+            return 1;
+    }
+    return stats.failed == 0 ? 0 : 1;
+}
+
+#ifndef SEAM_CARVING_NO_GUI
+// The original interactive flow: fixed input, size and algorithm from stdin, seams shown as they go
+static int runInteractive(Options options) {
+    std::string filename = "../SeamCarving/Assets/pietro.jpg";
     // Load the image
     Mat img = imread(filename);
     if (img.empty())
@@ -53,55 +552,67 @@ int main() {
         }
     } while (choice != GREEDY && choice != DYNAMIC);
 
-    while (img.cols > targetWidth || img.rows > targetHeight) {
-        if (img.cols > targetWidth) {
-            // Recalculate the energy map for the current image size
-            Mat energyMap = calculateEnergyMap(img);
-
-            // Find the vertical seam
-            vector<int> seamVertical;
+    options.algorithm = choice == GREEDY ? SeamAlgorithm::Greedy : SeamAlgorithm::DynamicProgramming;
 
-            if (choice == GREEDY)
-                seamVertical = findVerticalSeamGreedy(energyMap);
-            else
-                seamVertical = findVerticalSeam(energyMap);
+    // Visualize each seam before it is removed
+    SeamCarver carver;
+    carver.setSeamCallback([](const Mat& current, const vector<int>& seam, SeamDirection direction) {
+        Mat imgWithSeam = current.clone();
+        if (direction == SeamDirection::Vertical)
+            drawVerticalSeam(imgWithSeam, seam);
+        else
+            drawHorizontalSeam(imgWithSeam, seam);
+        imshow("Seam Carving", imgWithSeam);
+        waitKey(100);
+    });
+    img = carver.retarget(img, Size(targetWidth, targetHeight), options);
 
-            // Optional: visualize the seam before removal
-            Mat imgWithSeam = img.clone();
-            drawVerticalSeam(imgWithSeam, seamVertical);
-            imshow("Seam Carving", imgWithSeam);
-            waitKey(100);
-
-            // Remove the vertical seam
-            img = removeVerticalSeam(img, seamVertical);
-        }
-
-        if (img.rows > targetHeight) {
-            // Recalculate the energy map for the current image size
-            Mat energyMap = calculateEnergyMap(img);
-
-            // Find the horizontal seam
-            vector<int> seamHorizontal;
-            
-            if (choice == GREEDY)
-                seamHorizontal = findHorizontalSeamGreedy(energyMap);
-            else
-                seamHorizontal = findHorizontalSeam(energyMap);
-
-            // Optional: visualize the seam before removal
-            Mat imgWithSeam = img.clone();
-            drawHorizontalSeam(imgWithSeam, seamHorizontal);
-            imshow("Seam Carving", imgWithSeam);
-            waitKey(100);
-
-            // Remove the horizontal seam
-            img = removeHorizontalSeam(img, seamHorizontal);
-        }
+    if (options.verifyEnergy)
+        cout << "Incremental energy mismatches against full recompute: " << carver.energyMismatches() << endl;
+    // Only the initial sizing should show up here, every seam reuses the same DP buffers
+    cout << "DP buffer allocations: " << carver.finderContext().allocationCount() << endl;
+#if SEAM_ENABLE_PROFILING
+    for (int p = 0; p < static_cast<int>(Phase::Count); p++) {
+        Phase phase = static_cast<Phase>(p);
+        cout << phaseName(phase) << ": " << carver.profile().milliseconds(phase) << " ms in "
+            << carver.profile().phase(phase).calls << " calls" << endl;
     }
+#endif
 
     destroyAllWindows();
     imshow("Final Image", img);
-	imwrite("output.jpg", img); // Save the final image
+    imwrite("output.jpg", img); // Save the final image
     waitKey(0);
     return 0;
 }
+#endif
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+        return runBenchmarks(argc - 2, argv + 2);
+
+#ifndef SEAM_CARVING_NO_GUI
+    // No arguments (or only --verify-energy) keeps the original interactive behaviour
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "--verify-energy")) {
+        Options options;
+        options.verifyEnergy = argc == 2;
+        return runInteractive(options);
+    }
+#endif
+
+    CommandLine cmd;
+    if (!parseCommandLine(argc, argv, cmd)) {
+        printUsage();
+        return 2;
+    }
+    if (cmd.grain >= 0)
+        setSeamParallelGrain(cmd.grain);
+    if (cmd.indexMinWidth > 0) {
+        int status = runMakeIndex(cmd);
+        if (status != 0 || cmd.widths.empty())
+            return status;
+    }
+    if (!cmd.widths.empty())
+        return runWidths(cmd);
+    return cmd.batch.empty() ? runHeadless(cmd) : runBatch(cmd);
+}